@@ -0,0 +1,133 @@
+// Fan-out benchmark for bcast_ringbuffer.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Runs one writer against 0, 1, 4 and 16 reader threads and reports
+// the writer's throughput, the average reader throughput and the
+// share of values the readers lost to overruns. The run without
+// readers is the baseline for the writer. One CSV row is printed
+// per run.
+// 
+// Usage: bcast_bench [values per run] [values per write]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "bcast_ringbuffer.h"
+
+#define QUEUE_SIZE (1 << 16)
+#define MAX_CHUNK 4096
+
+typedef struct _bench_reader {
+	bcast_reader* reader;
+	uint32_t end;               // sequence number after the last value
+	uint64_t read;              // values actually read
+	double finished;            // when the last value was read
+	pthread_barrier_t* start;   // releases the readers with the writer
+} bench_reader;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* reader(void* arg)
+{
+	bench_reader* bench = arg;
+	char chunk[MAX_CHUNK];
+
+	pthread_barrier_wait(bench->start);
+	while (bench->reader->cursor != bench->end) {
+		size_t len = bcast_reader_read(bench->reader, chunk, sizeof(chunk));
+		if (len == 0)
+			sched_yield();
+		bench->read += len;
+	}
+
+	bench->finished = now();
+	return NULL;
+}
+
+static void bench(int readers, size_t values, size_t chunk)
+{
+	char data[MAX_CHUNK] = {0};
+	pthread_t threads[readers > 0 ? readers : 1];
+	bench_reader benches[readers > 0 ? readers : 1];
+	bcast_ringbuffer* rbuf = new_bcast_ringbuffer(QUEUE_SIZE);
+	pthread_barrier_t barrier;
+
+	// The readers are timed from when the writer starts, since a
+	// reader scheduled late would otherwise skip the values it missed.
+	pthread_barrier_init(&barrier, NULL, readers + 1);
+	for (int i = 0; i < readers; ++i) {
+		benches[i].reader = new_bcast_reader(rbuf);
+		benches[i].end = (uint32_t)values;
+		benches[i].read = 0;
+		benches[i].start = &barrier;
+		pthread_create(&threads[i], NULL, reader, &benches[i]);
+	}
+
+	pthread_barrier_wait(&barrier);
+	double start = now();
+	for (size_t i = 0; i < values; i += chunk)
+		bcast_ringbuffer_write(rbuf, data, values - i < chunk ? values - i : chunk);
+	double elapsed = now() - start;
+
+	double read_rate = 0, lost = 0;
+	for (int i = 0; i < readers; ++i) {
+		pthread_join(threads[i], NULL);
+		read_rate += benches[i].read / (benches[i].finished - start) / 1e6 / readers;
+		lost += (double)bcast_reader_lost(benches[i].reader) / values / readers;
+		delete_bcast_reader(benches[i].reader);
+	}
+
+	printf("%d,%zu,%zu,%.6f,%.3f,%.3f,%.2f\n", readers, values, chunk, elapsed,
+		values / elapsed / 1e6, read_rate, 100 * lost);
+	fflush(stdout);
+	pthread_barrier_destroy(&barrier);
+	delete_bcast_ringbuffer(rbuf);
+}
+
+int main(int argc, char** argv)
+{
+	size_t values = argc > 1 ? strtoull(argv[1], NULL, 10) : (1 << 26);
+	size_t chunk = argc > 2 ? strtoull(argv[2], NULL, 10) : 64;
+	int readers[] = { 0, 1, 4, 16 };
+
+	// Readers track progress by 32-bit sequence numbers.
+	if (values == 0 || values > UINT32_MAX || chunk == 0 || chunk > MAX_CHUNK) {
+		fprintf(stderr, "values must be below 2^32, values per write at most %d\n", MAX_CHUNK);
+		return 1;
+	}
+
+	printf("readers,values,chunk,seconds,writer_mops_per_sec,reader_mops_per_sec,lost_pct\n");
+	for (size_t i = 0; i < sizeof(readers) / sizeof(readers[0]); ++i)
+		bench(readers[i], values, chunk);
+	return 0;
+}
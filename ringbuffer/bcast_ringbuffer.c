@@ -0,0 +1,189 @@
+// A single-writer ring buffer that broadcasts to any number of readers.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <string.h>
+#include "bcast_ringbuffer.h"
+#include "ringbuffer_private.h"
+
+// Allocates a new bcast_ringbuffer with space for n elements
+// where n must be a power of 2. Each reader can fall up to n
+// values behind the writer before it loses values.
+// 
+// Returns a pointer to the newly allocated bcast_ringbuffer,
+// or NULL if n is not a power of 2.
+bcast_ringbuffer* new_bcast_ringbuffer(uint32_t n)
+{
+	if (n == 0 || !ISPOW2(n))
+		return NULL;
+
+	bcast_ringbuffer* rbuf = malloc(sizeof(bcast_ringbuffer));
+
+	if (rbuf != NULL) {
+		rbuf->max    = n;
+		rbuf->buffer = malloc(sizeof(char) * n);
+		atomic_init(&rbuf->claim, 0);
+		atomic_init(&rbuf->head, 0);
+	}
+
+	return rbuf;
+}
+
+// Frees memory used by bcast_ringbuffer. Its readers
+// must be deleted as well.
+void delete_bcast_ringbuffer(bcast_ringbuffer* rbuf)
+{
+	free(rbuf->buffer);
+	free(rbuf);
+}
+
+// Inserts the value at the head of the ringbuffer, overwriting
+// the oldest value when the buffer is full. Only one thread
+// may insert.
+void bcast_ringbuffer_insert(bcast_ringbuffer* rbuf, char value)
+{
+	bcast_ringbuffer_write(rbuf, &value, 1);
+}
+
+// Copies len values from src into the ringbuffer, overwriting
+// the oldest values when the buffer is full. Only one thread
+// may insert.
+// 
+// The claim is moved past the new values before they are written,
+// and the head after. A reader that copied values checks the claim
+// again afterwards, so it can tell if any of them were overwritten
+// while it was copying.
+void bcast_ringbuffer_write(bcast_ringbuffer* rbuf, const char* src, size_t len)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->head, memory_order_relaxed);
+	uint32_t end = head + (uint32_t)len;
+
+	// Values that would be overwritten within this same call are
+	// never copied, the head just moves past them.
+	if (len > rbuf->max) {
+		src += len - rbuf->max;
+		len = rbuf->max;
+		head = end - rbuf->max;
+	}
+
+	atomic_store_explicit(&rbuf->claim, end, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	uint32_t pos = MOD2(head, rbuf->max);
+	uint32_t first = rbuf->max - pos;
+	if (first > len)
+		first = (uint32_t)len;
+	memcpy(rbuf->buffer + pos, src, first);
+	memcpy(rbuf->buffer, src + first, len - first);
+
+	atomic_store_explicit(&rbuf->head, end, memory_order_release);
+}
+
+// Registers a new reader of the ringbuffer. The reader
+// starts with the next value inserted.
+// 
+// Returns a pointer to the newly allocated reader.
+bcast_reader* new_bcast_reader(bcast_ringbuffer* rbuf)
+{
+	bcast_reader* reader = malloc(sizeof(bcast_reader));
+
+	if (reader != NULL) {
+		reader->rbuf   = rbuf;
+		reader->cursor = atomic_load_explicit(&rbuf->head, memory_order_acquire);
+		reader->lost   = 0;
+	}
+
+	return reader;
+}
+
+// Frees memory used by a reader.
+void delete_bcast_reader(bcast_reader* reader)
+{
+	free(reader);
+}
+
+// Removes the next value for this reader and stores it in value.
+// If the writer overwrote values this reader had not read yet,
+// they are skipped and added to reader->lost.
+// 
+// Returns true if a value was removed, or false if there is no new value.
+bool bcast_reader_remove(bcast_reader* reader, char* value)
+{
+	return bcast_reader_read(reader, value, 1) == 1;
+}
+
+// Removes up to len values for this reader and copies them into
+// dst. Lost values are handled like in bcast_reader_remove.
+// 
+// Values are copied optimistically, since the writer does not wait
+// for readers. If the claim shows the writer has since started to
+// overwrite any of them, the copy is thrown away and retried from
+// the oldest value that is still intact.
+// 
+// Returns the number of values read, or 0 if there is no new value.
+size_t bcast_reader_read(bcast_reader* reader, char* dst, size_t len)
+{
+	bcast_ringbuffer* rbuf = reader->rbuf;
+
+	for (;;) {
+		uint32_t head = atomic_load_explicit(&rbuf->head, memory_order_acquire);
+		uint32_t avail = head - reader->cursor;
+
+		if (avail > rbuf->max) {
+			reader->lost += avail - rbuf->max;
+			reader->cursor = head - rbuf->max;
+			avail = rbuf->max;
+		}
+		if (len > avail)
+			len = avail;
+		if (len == 0)
+			return 0;
+
+		uint32_t pos = MOD2(reader->cursor, rbuf->max);
+		uint32_t first = rbuf->max - pos;
+		if (first > len)
+			first = (uint32_t)len;
+		memcpy(dst, rbuf->buffer + pos, first);
+		memcpy(dst + first, rbuf->buffer, len - first);
+
+		atomic_thread_fence(memory_order_acquire);
+		uint32_t claim = atomic_load_explicit(&rbuf->claim, memory_order_relaxed);
+
+		// The slot of sequence number s is reused by s+max, so the
+		// copy is intact while the claim does not pass cursor+max.
+		if (claim - reader->cursor <= rbuf->max) {
+			reader->cursor += (uint32_t)len;
+			return len;
+		}
+
+		reader->lost += claim - rbuf->max - reader->cursor;
+		reader->cursor = claim - rbuf->max;
+	}
+}
+
+// Returns the number of values this reader lost since it was
+// registered, because the writer overwrote them first.
+uint64_t bcast_reader_lost(bcast_reader* reader)
+{
+	return reader->lost;
+}
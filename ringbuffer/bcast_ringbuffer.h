@@ -0,0 +1,112 @@
+// A single-writer ring buffer that broadcasts to any number of readers.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _BCAST_RINGBUFFER_H_
+#define _BCAST_RINGBUFFER_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ringbuffer.h"
+
+// Like ringbuffer_insert, the writer never checks if the buffer is
+// full and overwrites the oldest values. Every reader has its own
+// cursor and sees every value, unless the writer laps it. A lapped
+// reader skips ahead to the oldest value that is still stored and
+// counts the values it lost. The writer never looks at the readers,
+// so they cannot slow it down.
+// 
+// Indices are free running sequence numbers, and only masked with
+// MOD2 when indexing the buffer.
+// 
+// No ringbuffer_counters are kept, even with RINGBUFFER_STATS. The
+// writer's count is its head, and bcast_reader_lost reports each
+// reader's overruns.
+typedef struct _bcast_ringbuffer {
+	uint32_t max;                   // max number of elements in the buffer
+	char* buffer;                   // underlying buffer
+	char pad0[RINGBUFFER_CACHE_LINE];
+	_Atomic uint32_t claim;         // end of the values being written
+	_Atomic uint32_t head;          // end of the values written
+	char pad1[RINGBUFFER_CACHE_LINE];
+} bcast_ringbuffer;
+
+// A reader of a bcast_ringbuffer, owned by a single thread.
+typedef struct _bcast_reader {
+	bcast_ringbuffer* rbuf;         // buffer being read
+	uint32_t cursor;                // sequence number of the next value to read
+	uint64_t lost;                  // values overwritten before they were read
+	char pad[RINGBUFFER_CACHE_LINE];
+} bcast_reader;
+
+// Allocates a new bcast_ringbuffer with space for n elements
+// where n must be a power of 2. Each reader can fall up to n
+// values behind the writer before it loses values.
+// 
+// Returns a pointer to the newly allocated bcast_ringbuffer,
+// or NULL if n is not a power of 2.
+bcast_ringbuffer* new_bcast_ringbuffer(uint32_t n);
+
+// Frees memory used by bcast_ringbuffer. Its readers
+// must be deleted as well.
+void delete_bcast_ringbuffer(bcast_ringbuffer* rbuf);
+
+// Inserts the value at the head of the ringbuffer, overwriting
+// the oldest value when the buffer is full. Only one thread
+// may insert.
+void bcast_ringbuffer_insert(bcast_ringbuffer* rbuf, char value);
+
+// Copies len values from src into the ringbuffer, overwriting
+// the oldest values when the buffer is full. Only one thread
+// may insert.
+void bcast_ringbuffer_write(bcast_ringbuffer* rbuf, const char* src, size_t len);
+
+// Registers a new reader of the ringbuffer. The reader
+// starts with the next value inserted.
+// 
+// Returns a pointer to the newly allocated reader.
+bcast_reader* new_bcast_reader(bcast_ringbuffer* rbuf);
+
+// Frees memory used by a reader.
+void delete_bcast_reader(bcast_reader* reader);
+
+// Removes the next value for this reader and stores it in value.
+// If the writer overwrote values this reader had not read yet,
+// they are skipped and added to reader->lost.
+// 
+// Returns true if a value was removed, or false if there is no new value.
+bool bcast_reader_remove(bcast_reader* reader, char* value);
+
+// Removes up to len values for this reader and copies them into
+// dst. Lost values are handled like in bcast_reader_remove.
+// 
+// Returns the number of values read, or 0 if there is no new value.
+size_t bcast_reader_read(bcast_reader* reader, char* dst, size_t len);
+
+// Returns the number of values this reader lost since it was
+// registered, because the writer overwrote them first.
+uint64_t bcast_reader_lost(bcast_reader* reader);
+
+#endif
@@ -0,0 +1,362 @@
+// Throughput and latency benchmark for the ringbuffer operations.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Measures ringbuffer_insert, ringbuffer_sfinsert, ringbuffer_remove
+// and ringbuffer_peek on a single thread, and inserts and removes on
+// a producer/consumer thread pair, both through spsc_ringbuffer and
+// through a ringbuffer guarded by a mutex. It also measures the
+// amortized cost of grow_ringbuffer_insert while the buffer grows from
+// a single element to its limit, next to the same inserts into a
+// buffer reserved up front. Every run is repeated for buffer sizes from
+// 2^min to 2^max.
+// 
+// Operations are timed in batches, since a clock read costs more than
+// a single operation. The latency of a run is the distribution of the
+// average time per operation over its batches, reported as p50/p99 and
+// as a histogram with power of two buckets in picoseconds. Results are
+// printed as CSV, or as JSON with --json, so they can be saved and
+// compared between commits.
+// 
+// Usage: bench [--json] [--ops n] [--min log2] [--max log2]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "ringbuffer.h"
+#include "spsc_ringbuffer.h"
+#include "grow_ringbuffer.h"
+
+#define MAX_BATCH 64
+#define BUCKETS 32
+
+typedef struct _result {
+	const char* mode;           // "single", "spsc", "mutex" or "grow"
+	const char* op;
+	uint32_t size;
+	uint64_t ops;
+	double seconds;
+	uint32_t batch;             // operations per timed batch
+	uint32_t batches;
+	double* samples;            // picoseconds per operation, per batch
+} result;
+
+typedef struct _options {
+	bool json;
+	uint64_t ops;
+	int min_log2;
+	int max_log2;
+} options;
+
+// Keeps the compiler from dropping the operations under test.
+static volatile char sink;
+
+static int results_printed = 0;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// Prints a result in the selected format and frees its samples.
+static void print_result(options* opts, result* res)
+{
+	uint64_t histogram[BUCKETS] = {0};
+
+	for (uint32_t i = 0; i < res->batches; ++i) {
+		int bucket = 0;
+		for (double ps = res->samples[i]; ps >= 2 && bucket < BUCKETS - 1; ps /= 2)
+			++bucket;
+		++histogram[bucket];
+	}
+	qsort(res->samples, res->batches, sizeof(double), compare_double);
+	double p50 = res->samples[res->batches / 2] / 1000;
+	double p99 = res->samples[res->batches * 99 / 100] / 1000;
+	double mops = res->ops / res->seconds / 1e6;
+
+	if (opts->json) {
+		printf("%s\n  {\"mode\": \"%s\", \"op\": \"%s\", \"size\": %u, \"ops\": %llu, "
+			"\"seconds\": %.6f, \"mops_per_sec\": %.3f, \"p50_ns\": %.3f, \"p99_ns\": %.3f, "
+			"\"histogram_ps_log2\": [", results_printed ? "," : "[", res->mode, res->op,
+			res->size, (unsigned long long)res->ops, res->seconds, mops, p50, p99);
+		for (int i = 0; i < BUCKETS; ++i)
+			printf("%s%llu", i ? ", " : "", (unsigned long long)histogram[i]);
+		printf("]}");
+	} else {
+		if (!results_printed)
+			printf("mode,op,size,ops,seconds,mops_per_sec,p50_ns,p99_ns,histogram_ps_log2\n");
+		printf("%s,%s,%u,%llu,%.6f,%.3f,%.3f,%.3f,", res->mode, res->op, res->size,
+			(unsigned long long)res->ops, res->seconds, mops, p50, p99);
+		for (int i = 0; i < BUCKETS; ++i)
+			printf("%s%llu", i ? ";" : "", (unsigned long long)histogram[i]);
+		printf("\n");
+	}
+	fflush(stdout);
+
+	++results_printed;
+	free(res->samples);
+}
+
+// Sets up a result for ops operations, rounded down to whole batches.
+// Batches are at most half the buffer size, so that a batch of
+// removes never runs out of values.
+static void init_result(result* res, const char* mode, const char* op, uint32_t size, uint64_t ops)
+{
+	res->mode = mode;
+	res->op = op;
+	res->size = size;
+	res->batch = size / 2 < MAX_BATCH ? size / 2 : MAX_BATCH;
+	res->ops = ops / res->batch * res->batch;
+	res->seconds = 0;
+	res->batches = 0;
+	res->samples = malloc(sizeof(double) * (ops / res->batch + 1));
+}
+
+// Adds the time of one batch of operations to the result.
+static void add_batch(result* res, double start, double end)
+{
+	res->seconds += end - start;
+	res->samples[res->batches++] = (end - start) * 1e12 / res->batch;
+}
+
+// Times one of the single threaded operations. The buffer is
+// refilled or emptied between batches, outside the timed part,
+// so every batch runs the operation on its normal path.
+static void bench_single(options* opts, const char* op, uint32_t size)
+{
+	result res;
+	ringbuffer* rbuf = new_ringbuffer(size);
+	char value = 0;
+
+	init_result(&res, "single", op, size, opts->ops);
+	memset(rbuf->buffer, 0, size);
+
+	for (uint64_t i = 0; i < res.ops; i += res.batch) {
+		double start, end;
+
+		if (strcmp(op, "insert") == 0) {
+			start = now();
+			for (uint32_t j = 0; j < res.batch; ++j)
+				ringbuffer_insert(rbuf, value++);
+			end = now();
+		} else if (strcmp(op, "sfinsert") == 0) {
+			if (size - 1 - ringbuffer_count(rbuf) < res.batch)
+				rbuf->tail = rbuf->head;
+			start = now();
+			for (uint32_t j = 0; j < res.batch; ++j)
+				ringbuffer_sfinsert(rbuf, value++);
+			end = now();
+		} else if (strcmp(op, "remove") == 0) {
+			if (ringbuffer_count(rbuf) < res.batch)
+				rbuf->head = (rbuf->tail + size - 1) & (size - 1);
+			start = now();
+			for (uint32_t j = 0; j < res.batch; ++j)
+				value += ringbuffer_remove(rbuf);
+			end = now();
+		} else {
+			if (ringbuffer_isempty(rbuf))
+				ringbuffer_insert(rbuf, value);
+			start = now();
+			for (uint32_t j = 0; j < res.batch; ++j)
+				value += ringbuffer_peek(rbuf);
+			end = now();
+		}
+
+		add_batch(&res, start, end);
+	}
+
+	sink = value;
+	delete_ringbuffer(rbuf);
+	print_result(opts, &res);
+}
+
+// Times grow_ringbuffer_insert until the buffer holds size values,
+// starting over with a new buffer once it is full. With op "insert"
+// every new buffer starts at 1 element and grows up to size, so the
+// resizes are part of the timed inserts. With op "reserved" it is
+// allocated at size and never grows, as a baseline.
+static void bench_grow(options* opts, const char* op, uint32_t size)
+{
+	result res;
+	bool reserved = strcmp(op, "reserved") == 0;
+	uint32_t initial = reserved ? size : 1;
+	grow_ringbuffer* rbuf = new_grow_ringbuffer(initial, size);
+	char value = 0;
+
+	init_result(&res, "grow", op, size, opts->ops);
+
+	for (uint64_t i = 0; i < res.ops; i += res.batch) {
+		if (size - grow_ringbuffer_count(rbuf) < res.batch) {
+			delete_grow_ringbuffer(rbuf);
+			rbuf = new_grow_ringbuffer(initial, size);
+		}
+
+		double start = now();
+		for (uint32_t j = 0; j < res.batch; ++j)
+			grow_ringbuffer_insert(rbuf, value++);
+		double end = now();
+
+		add_batch(&res, start, end);
+	}
+
+	delete_grow_ringbuffer(rbuf);
+	print_result(opts, &res);
+}
+
+typedef struct _pair_run {
+	bool spsc;
+	spsc_ringbuffer* queue;
+	ringbuffer* rbuf;
+	pthread_mutex_t lock;
+	uint64_t ops;
+} pair_run;
+
+static bool pair_insert(pair_run* run, char value)
+{
+	if (run->spsc)
+		return spsc_ringbuffer_insert(run->queue, value);
+
+	pthread_mutex_lock(&run->lock);
+	bool success = ringbuffer_sfinsert(run->rbuf, value);
+	pthread_mutex_unlock(&run->lock);
+	return success;
+}
+
+static bool pair_remove(pair_run* run, char* value)
+{
+	if (run->spsc)
+		return spsc_ringbuffer_remove(run->queue, value);
+
+	bool success = false;
+	pthread_mutex_lock(&run->lock);
+	if (!ringbuffer_isempty(run->rbuf)) {
+		*value = ringbuffer_remove(run->rbuf);
+		success = true;
+	}
+	pthread_mutex_unlock(&run->lock);
+	return success;
+}
+
+static void* pair_producer(void* arg)
+{
+	pair_run* run = arg;
+
+	for (uint64_t i = 0; i < run->ops; ) {
+		if (pair_insert(run, (char)i))
+			++i;
+		else
+			sched_yield();
+	}
+	return NULL;
+}
+
+// Times inserts on a producer thread against removes on the calling
+// thread. Batches are timed on the consumer, so the latency is the
+// time per value handed over, including any waiting on the producer.
+static void bench_pair(options* opts, bool spsc, uint32_t size)
+{
+	result res;
+	pair_run run;
+	pthread_t producer;
+	char value = 0;
+
+	init_result(&res, spsc ? "spsc" : "mutex", "insert+remove", size, opts->ops);
+	run.spsc = spsc;
+	run.ops = res.ops;
+	run.queue = new_spsc_ringbuffer(size);
+	run.rbuf = new_ringbuffer(size);
+	pthread_mutex_init(&run.lock, NULL);
+
+	pthread_create(&producer, NULL, pair_producer, &run);
+	for (uint64_t i = 0; i < res.ops; i += res.batch) {
+		double start = now();
+		for (uint32_t j = 0; j < res.batch; ) {
+			if (pair_remove(&run, &value))
+				++j;
+			else
+				sched_yield();
+		}
+		add_batch(&res, start, now());
+	}
+	pthread_join(producer, NULL);
+
+	sink = value;
+	pthread_mutex_destroy(&run.lock);
+	delete_ringbuffer(run.rbuf);
+	delete_spsc_ringbuffer(run.queue);
+	print_result(opts, &res);
+}
+
+int main(int argc, char** argv)
+{
+	options opts = { false, 1 << 22, 4, 24 };
+	const char* ops[] = { "insert", "sfinsert", "remove", "peek" };
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0)
+			opts.json = true;
+		else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+			opts.ops = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc)
+			opts.min_log2 = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+			opts.max_log2 = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "usage: %s [--json] [--ops n] [--min log2] [--max log2]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (opts.min_log2 < 2 || opts.max_log2 > 31 || opts.min_log2 > opts.max_log2
+			|| opts.ops < MAX_BATCH) {
+		fprintf(stderr, "sizes must be between 2^2 and 2^31, and ops at least %d\n", MAX_BATCH);
+		return 1;
+	}
+
+	for (int log2 = opts.min_log2; log2 <= opts.max_log2; ++log2) {
+		uint32_t size = (uint32_t)1 << log2;
+		for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i)
+			bench_single(&opts, ops[i], size);
+		bench_pair(&opts, true, size);
+		bench_pair(&opts, false, size);
+		bench_grow(&opts, "insert", size);
+		bench_grow(&opts, "reserved", size);
+	}
+
+	if (opts.json)
+		printf("\n]\n");
+	return 0;
+}
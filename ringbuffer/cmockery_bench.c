@@ -0,0 +1,152 @@
+// Benchmark for the cmockery features the unit tests lean on.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Times test_malloc/test_free pairs with and without fill patterns,
+// and will_return/mock and expect_value/check_expected round trips
+// over many distinct symbols. Each run is a cmockery test, so the
+// allocator hooks and symbol maps work as they do in the unit tests.
+// One CSV row is printed per run once all of them are done.
+// 
+// Usage: cmockery_bench [operations per run] [symbols]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <google/cmockery.h>
+
+#define MAX_SYMBOLS 100000
+#define MAX_RUNS 8
+
+typedef struct _bench_result {
+	const char* name;
+	unsigned long long ops;
+	double seconds;
+} bench_result;
+
+static unsigned long long ops = 1 << 20;
+static unsigned symbols = 1000;
+static char names[MAX_SYMBOLS][24];
+static bench_result results[MAX_RUNS];
+static int runs = 0;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void add_result(const char* name, unsigned long long count, double seconds)
+{
+	results[runs].name = name;
+	results[runs].ops = count;
+	results[runs].seconds = seconds;
+	++runs;
+}
+
+// Allocates and frees ops blocks of size bytes.
+static void bench_malloc(const char* name, size_t size, int fill)
+{
+	set_malloc_fill_patterns(fill);
+	double start = now();
+	for (unsigned long long i = 0; i < ops; ++i) {
+		char* block = test_malloc(size);
+		block[0] = (char)i;
+		test_free(block);
+	}
+	add_result(name, ops, now() - start);
+	set_malloc_fill_patterns(1);
+}
+
+void bench_malloc_64_fill(void **state) { bench_malloc("malloc_64_fill", 64, 1); }
+void bench_malloc_64(void **state) { bench_malloc("malloc_64", 64, 0); }
+void bench_malloc_4096_fill(void **state) { bench_malloc("malloc_4096_fill", 4096, 1); }
+void bench_malloc_4096(void **state) { bench_malloc("malloc_4096", 4096, 0); }
+
+// Queues a return value for every symbol, then retrieves them all,
+// until ops values went through the symbol map.
+void bench_will_return(void **state)
+{
+	unsigned long long count = 0;
+	double start = now();
+	while (count < ops) {
+		for (unsigned i = 0; i < symbols; ++i)
+			_will_return(names[i], __FILE__, __LINE__, i, 1);
+		for (unsigned i = 0; i < symbols; ++i)
+			assert_int_equal(_mock(names[i], __FILE__, __LINE__), i);
+		count += symbols;
+	}
+	add_result("will_return_mock", count, now() - start);
+}
+
+// Like bench_will_return, but through the parameter map.
+void bench_expect_value(void **state)
+{
+	unsigned long long count = 0;
+	double start = now();
+	while (count < ops) {
+		for (unsigned i = 0; i < symbols; ++i)
+			_expect_value(names[i], "value", __FILE__, __LINE__, i, 1);
+		for (unsigned i = 0; i < symbols; ++i)
+			_check_expected(names[i], "value", __FILE__, __LINE__, i);
+		count += symbols;
+	}
+	add_result("expect_value_check", count, now() - start);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		ops = strtoull(argv[1], NULL, 10);
+	if (argc > 2)
+		symbols = (unsigned)atoi(argv[2]);
+	if (ops == 0 || symbols == 0 || symbols > MAX_SYMBOLS) {
+		fprintf(stderr, "usage: %s [operations per run] [symbols, at most %d]\n",
+			argv[0], MAX_SYMBOLS);
+		return 1;
+	}
+	for (unsigned i = 0; i < symbols; ++i)
+		snprintf(names[i], sizeof(names[i]), "function_%u", i);
+
+	const UnitTest tests[] = {
+		unit_test(bench_malloc_64_fill),
+		unit_test(bench_malloc_64),
+		unit_test(bench_malloc_4096_fill),
+		unit_test(bench_malloc_4096),
+		unit_test(bench_will_return),
+		unit_test(bench_expect_value)
+	};
+	int failed = run_tests(tests);
+
+	printf("run,ops,seconds,ns_per_op\n");
+	for (int i = 0; i < runs; ++i)
+		printf("%s,%llu,%.6f,%.1f\n", results[i].name, results[i].ops,
+			results[i].seconds, results[i].seconds * 1e9 / results[i].ops);
+	return failed;
+}
@@ -0,0 +1,229 @@
+// A ring buffer that can grow and shrink while it holds data.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <string.h>
+#include "grow_ringbuffer.h"
+#include "ringbuffer_private.h"
+
+// Allocates a new grow_ringbuffer with space for n elements, where
+// n must be a power of 2. Inserting into the full buffer doubles its
+// size until it holds limit elements, which must be a power of 2 no
+// less than n. Pass limit = n to never grow automatically.
+// 
+// Returns a pointer to the newly allocated grow_ringbuffer,
+// or NULL if n or limit is not valid.
+grow_ringbuffer* new_grow_ringbuffer(uint32_t n, uint32_t limit)
+{
+	if (n == 0 || !ISPOW2(n) || !ISPOW2(limit) || limit < n)
+		return NULL;
+
+	grow_ringbuffer* rbuf = malloc(sizeof(grow_ringbuffer));
+
+	if (rbuf != NULL) {
+		rbuf->max    = n;
+		rbuf->limit  = limit;
+		rbuf->tail   = 0;
+		rbuf->head   = 0;
+		rbuf->buffer = malloc(sizeof(char) * n);
+	}
+
+	return rbuf;
+}
+
+// Frees memory used by grow_ringbuffer.
+void delete_grow_ringbuffer(grow_ringbuffer* rbuf)
+{
+	free(rbuf->buffer);
+	free(rbuf);
+}
+
+// Copies len values from the buffer starting at index pos into dst,
+// splitting the copy around the wrap point.
+static void grow_ringbuffer_copyout(grow_ringbuffer* rbuf, uint32_t pos, char* dst, uint32_t len)
+{
+	pos = MOD2(pos, rbuf->max);
+	uint32_t first = rbuf->max - pos;
+	if (first > len)
+		first = len;
+	memcpy(dst, rbuf->buffer + pos, first);
+	memcpy(dst + first, rbuf->buffer, len - first);
+}
+
+// Resizes the ringbuffer to hold n elements, rounded up to a power
+// of 2. The buffer shrinks if n is less than its current size, but
+// never below the number of values it holds. Stored values are kept
+// in order. This is not bound by the limit for automatic growth.
+// 
+// The stored values are unwrapped to the start of the new buffer,
+// which takes at most two copies, and the indices are rebased.
+// 
+// Returns true if successful, or false if n is over 2^31 or the new
+// buffer could not be allocated, in which case the ringbuffer is left
+// unchanged.
+bool grow_ringbuffer_reserve(grow_ringbuffer* rbuf, uint32_t n)
+{
+	uint32_t count = grow_ringbuffer_count(rbuf);
+	if (n < count)
+		n = count;
+	if (n == 0)
+		n = 1;
+
+	// Round up to the next power of 2.
+	uint32_t max = 1;
+	while (max < n) {
+		if (max > UINT32_MAX / 2)
+			return false;
+		max <<= 1;
+	}
+	if (max == rbuf->max)
+		return true;
+
+	char* buffer = malloc(sizeof(char) * max);
+	if (buffer == NULL)
+		return false;
+
+	grow_ringbuffer_copyout(rbuf, rbuf->tail, buffer, count);
+	free(rbuf->buffer);
+	rbuf->buffer = buffer;
+	rbuf->max    = max;
+	rbuf->tail   = 0;
+	rbuf->head   = count;
+	return true;
+}
+
+// Makes room for need more values, doubling the buffer as often as
+// needed but not past its limit.
+// 
+// Returns the number of free slots afterwards.
+static uint32_t grow_ringbuffer_makeroom(grow_ringbuffer* rbuf, size_t need)
+{
+	uint32_t count = grow_ringbuffer_count(rbuf);
+	if (rbuf->max - count >= need || rbuf->max >= rbuf->limit)
+		return rbuf->max - count;
+
+	uint32_t max = rbuf->max;
+	while (max < rbuf->limit && max - count < need)
+		max <<= 1;
+
+	grow_ringbuffer_reserve(rbuf, max);
+	return rbuf->max - count;
+}
+
+// Inserts the value at the head of the ringbuffer. If the buffer
+// is full it grows first, unless it already reached its limit.
+// 
+// Returns true if insertion was successful, or false if the buffer
+// is full and cannot grow.
+bool grow_ringbuffer_insert(grow_ringbuffer* rbuf, char value)
+{
+	if (grow_ringbuffer_isfull(rbuf) && grow_ringbuffer_makeroom(rbuf, 1) == 0)
+		return false;
+
+	rbuf->buffer[MOD2(rbuf->head, rbuf->max)] = value;
+	rbuf->head++;
+	return true;
+}
+
+// Removes the value at the tail of the ringbuffer and stores it in value.
+// 
+// Returns true if a value was removed, or false if the buffer is empty.
+bool grow_ringbuffer_remove(grow_ringbuffer* rbuf, char* value)
+{
+	if (grow_ringbuffer_isempty(rbuf))
+		return false;
+
+	*value = rbuf->buffer[MOD2(rbuf->tail, rbuf->max)];
+	rbuf->tail++;
+	return true;
+}
+
+// Stores the value at the tail of the ringbuffer in value without removing it.
+// 
+// Returns true if there was a value, or false if the buffer is empty.
+bool grow_ringbuffer_peek(grow_ringbuffer* rbuf, char* value)
+{
+	if (grow_ringbuffer_isempty(rbuf))
+		return false;
+
+	*value = rbuf->buffer[MOD2(rbuf->tail, rbuf->max)];
+	return true;
+}
+
+// Copies up to len values from src into the ringbuffer, growing it
+// as needed up to its limit.
+// 
+// Returns the number of values written, which may be less than len.
+size_t grow_ringbuffer_write(grow_ringbuffer* rbuf, const char* src, size_t len)
+{
+	uint32_t space = grow_ringbuffer_makeroom(rbuf, len);
+	if (len > space)
+		len = space;
+
+	uint32_t pos = MOD2(rbuf->head, rbuf->max);
+	uint32_t first = rbuf->max - pos;
+	if (first > len)
+		first = (uint32_t)len;
+	memcpy(rbuf->buffer + pos, src, first);
+	memcpy(rbuf->buffer, src + first, len - first);
+
+	rbuf->head += (uint32_t)len;
+	return len;
+}
+
+// Removes up to len values from the tail of the ringbuffer
+// and copies them into dst.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t grow_ringbuffer_read(grow_ringbuffer* rbuf, char* dst, size_t len)
+{
+	uint32_t count = grow_ringbuffer_count(rbuf);
+	if (len > count)
+		len = count;
+
+	grow_ringbuffer_copyout(rbuf, rbuf->tail, dst, (uint32_t)len);
+	rbuf->tail += (uint32_t)len;
+	return len;
+}
+
+// Returns the number of values currently stored in the ringbuffer.
+uint32_t grow_ringbuffer_count(grow_ringbuffer* rbuf)
+{
+	return rbuf->head - rbuf->tail;
+}
+
+// Checks if the ringbuffer instance is empty.
+// 
+// Returns true if it is empty, else it returns false.
+bool grow_ringbuffer_isempty(grow_ringbuffer* rbuf)
+{
+	return rbuf->head == rbuf->tail;
+}
+
+// Checks if the ringbuffer instance is full at its current size.
+// 
+// Returns true if it is full, else it returns false.
+bool grow_ringbuffer_isfull(grow_ringbuffer* rbuf)
+{
+	return rbuf->head - rbuf->tail == rbuf->max;
+}
@@ -0,0 +1,109 @@
+// A ring buffer that can grow and shrink while it holds data.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _GROW_RINGBUFFER_H_
+#define _GROW_RINGBUFFER_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ringbuffer.h"
+
+// Unlike ringbuffer, the head and tail are free running and only
+// masked with MOD2 when indexing the buffer. The buffer is empty when
+// they are equal and full when they are max apart, so all n slots
+// are usable.
+typedef struct _grow_ringbuffer {
+	uint32_t max;     // max number of elements in the buffer
+	uint32_t limit;   // max number of elements automatic growth may reach
+	uint32_t head;    // input
+	uint32_t tail;    // output
+	char* buffer;     // underlying buffer
+} grow_ringbuffer;
+
+// Allocates a new grow_ringbuffer with space for n elements, where
+// n must be a power of 2. Inserting into the full buffer doubles its
+// size until it holds limit elements, which must be a power of 2 no
+// less than n. Pass limit = n to never grow automatically.
+// 
+// Returns a pointer to the newly allocated grow_ringbuffer,
+// or NULL if n or limit is not valid.
+grow_ringbuffer* new_grow_ringbuffer(uint32_t n, uint32_t limit);
+
+// Frees memory used by grow_ringbuffer.
+void delete_grow_ringbuffer(grow_ringbuffer* rbuf);
+
+// Resizes the ringbuffer to hold n elements, rounded up to a power
+// of 2. The buffer shrinks if n is less than its current size, but
+// never below the number of values it holds. Stored values are kept
+// in order. This is not bound by the limit for automatic growth.
+// 
+// Returns true if successful, or false if n is over 2^31 or the new
+// buffer could not be allocated, in which case the ringbuffer is left
+// unchanged.
+bool grow_ringbuffer_reserve(grow_ringbuffer* rbuf, uint32_t n);
+
+// Inserts the value at the head of the ringbuffer. If the buffer
+// is full it grows first, unless it already reached its limit.
+// 
+// Returns true if insertion was successful, or false if the buffer
+// is full and cannot grow.
+bool grow_ringbuffer_insert(grow_ringbuffer* rbuf, char value);
+
+// Removes the value at the tail of the ringbuffer and stores it in value.
+// 
+// Returns true if a value was removed, or false if the buffer is empty.
+bool grow_ringbuffer_remove(grow_ringbuffer* rbuf, char* value);
+
+// Stores the value at the tail of the ringbuffer in value without removing it.
+// 
+// Returns true if there was a value, or false if the buffer is empty.
+bool grow_ringbuffer_peek(grow_ringbuffer* rbuf, char* value);
+
+// Copies up to len values from src into the ringbuffer, growing it
+// as needed up to its limit.
+// 
+// Returns the number of values written, which may be less than len.
+size_t grow_ringbuffer_write(grow_ringbuffer* rbuf, const char* src, size_t len);
+
+// Removes up to len values from the tail of the ringbuffer
+// and copies them into dst.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t grow_ringbuffer_read(grow_ringbuffer* rbuf, char* dst, size_t len);
+
+// Returns the number of values currently stored in the ringbuffer.
+uint32_t grow_ringbuffer_count(grow_ringbuffer* rbuf);
+
+// Checks if the ringbuffer instance is empty.
+// 
+// Returns true if it is empty, else it returns false.
+bool grow_ringbuffer_isempty(grow_ringbuffer* rbuf);
+
+// Checks if the ringbuffer instance is full at its current size.
+// 
+// Returns true if it is full, else it returns false.
+bool grow_ringbuffer_isfull(grow_ringbuffer* rbuf);
+
+#endif
@@ -0,0 +1,194 @@
+// Contention benchmark for mpmc_queue.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Scales the number of producers and consumers from 1 to N and
+// reports the throughput of mpmc_queue next to a ringbuffer
+// guarded by a single mutex. One CSV row is printed per run.
+// 
+// Usage: mpmc_bench [max threads per side] [values per run]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "ringbuffer.h"
+#include "mpmc_queue.h"
+
+#define QUEUE_SIZE 1024
+#define SPINS_BEFORE_YIELD 64
+
+typedef struct _bench_queue {
+	const char* name;
+	bool (*enqueue)(void* queue, char value);
+	bool (*dequeue)(void* queue, char* value);
+	void* queue;
+} bench_queue;
+
+typedef struct _locked_ringbuffer {
+	pthread_mutex_t lock;
+	ringbuffer* rbuf;
+} locked_ringbuffer;
+
+typedef struct _bench_run {
+	bench_queue* queue;
+	uint64_t per_producer;
+	uint64_t total;
+	atomic_uint_fast64_t consumed;
+} bench_run;
+
+static bool mpmc_enqueue(void* queue, char value)
+{
+	return mpmc_queue_enqueue(queue, value);
+}
+
+static bool mpmc_dequeue(void* queue, char* value)
+{
+	return mpmc_queue_dequeue(queue, value);
+}
+
+static bool locked_enqueue(void* queue, char value)
+{
+	locked_ringbuffer* locked = queue;
+	pthread_mutex_lock(&locked->lock);
+	bool success = ringbuffer_sfinsert(locked->rbuf, value);
+	pthread_mutex_unlock(&locked->lock);
+	return success;
+}
+
+static bool locked_dequeue(void* queue, char* value)
+{
+	locked_ringbuffer* locked = queue;
+	bool success = false;
+	pthread_mutex_lock(&locked->lock);
+	if (!ringbuffer_isempty(locked->rbuf)) {
+		*value = ringbuffer_remove(locked->rbuf);
+		success = true;
+	}
+	pthread_mutex_unlock(&locked->lock);
+	return success;
+}
+
+// Spins on a failed queue operation for a while, then gives
+// up the core so oversubscribed runs still make progress.
+static void backoff(unsigned* spins)
+{
+	if (++*spins >= SPINS_BEFORE_YIELD) {
+		*spins = 0;
+		sched_yield();
+	}
+}
+
+static void* producer(void* arg)
+{
+	bench_run* run = arg;
+	unsigned spins = 0;
+
+	for (uint64_t i = 0; i < run->per_producer; ) {
+		if (run->queue->enqueue(run->queue->queue, (char)i))
+			++i;
+		else
+			backoff(&spins);
+	}
+	return NULL;
+}
+
+static void* consumer(void* arg)
+{
+	bench_run* run = arg;
+	unsigned spins = 0;
+	char value;
+
+	while (atomic_load_explicit(&run->consumed, memory_order_relaxed) < run->total) {
+		if (run->queue->dequeue(run->queue->queue, &value))
+			atomic_fetch_add_explicit(&run->consumed, 1, memory_order_relaxed);
+		else
+			backoff(&spins);
+	}
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Moves the given number of values through the queue with the given number
+// of producer and consumer threads, and prints the result.
+static void bench(bench_queue* queue, int producers, int consumers, uint64_t values)
+{
+	pthread_t threads[producers + consumers];
+	bench_run run;
+
+	run.queue = queue;
+	run.per_producer = values / producers;
+	run.total = run.per_producer * producers;
+	atomic_init(&run.consumed, 0);
+
+	double start = now();
+	for (int i = 0; i < producers; ++i)
+		pthread_create(&threads[i], NULL, producer, &run);
+	for (int i = 0; i < consumers; ++i)
+		pthread_create(&threads[producers + i], NULL, consumer, &run);
+	for (int i = 0; i < producers + consumers; ++i)
+		pthread_join(threads[i], NULL);
+	double elapsed = now() - start;
+
+	printf("%s,%d,%d,%llu,%.6f,%.3f\n", queue->name, producers, consumers,
+		(unsigned long long)run.total, elapsed, run.total / elapsed / 1e6);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int max_threads = argc > 1 ? atoi(argv[1]) : (cores > 1 ? (int)cores : 2);
+	uint64_t values = argc > 2 ? strtoull(argv[2], NULL, 10) : (1 << 22);
+
+	locked_ringbuffer locked;
+	pthread_mutex_init(&locked.lock, NULL);
+	locked.rbuf = new_ringbuffer(QUEUE_SIZE);
+
+	bench_queue queues[] = {
+		{ "mpmc_queue", mpmc_enqueue, mpmc_dequeue, new_mpmc_queue(QUEUE_SIZE) },
+		{ "mutex_ringbuffer", locked_enqueue, locked_dequeue, &locked },
+	};
+
+	printf("queue,producers,consumers,values,seconds,mops_per_sec\n");
+	for (size_t q = 0; q < sizeof(queues) / sizeof(queues[0]); ++q)
+		for (int p = 1; p <= max_threads; ++p)
+			for (int c = 1; c <= max_threads; ++c)
+				bench(&queues[q], p, c, values);
+
+	delete_mpmc_queue(queues[0].queue);
+	delete_ringbuffer(locked.rbuf);
+	pthread_mutex_destroy(&locked.lock);
+	return 0;
+}
@@ -0,0 +1,135 @@
+// A lock-free, bounded, multi-producer/multi-consumer queue.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "mpmc_queue.h"
+#include "ringbuffer_private.h"
+
+// Allocates a new mpmc_queue with space for n elements where
+// n must be a power of 2 and at least 2. Unlike ringbuffer, all
+// n slots are usable since the per-slot sequence numbers tell the
+// full and empty states apart. A single slot cannot, as "ready to
+// read at pos" and "free to write at pos+1" would be the same number.
+// 
+// Returns a pointer to the newly allocated mpmc_queue,
+// or NULL if n is less than 2 or not a power of 2.
+mpmc_queue* new_mpmc_queue(uint32_t n)
+{
+	if (n < 2 || !ISPOW2(n))
+		return NULL;
+
+	mpmc_queue* queue = malloc(sizeof(mpmc_queue));
+
+	if (queue != NULL) {
+		queue->max    = n;
+		queue->buffer = malloc(sizeof(mpmc_cell) * n);
+		atomic_init(&queue->head, 0);
+		atomic_init(&queue->tail, 0);
+
+		// Slot i is first free for the producer claiming position i.
+		for (uint32_t i = 0; i < n; ++i)
+			atomic_init(&queue->buffer[i].sequence, i);
+	}
+
+	return queue;
+}
+
+// Frees memory used by mpmc_queue. No thread
+// may be using the queue anymore.
+void delete_mpmc_queue(mpmc_queue* queue)
+{
+	free(queue->buffer);
+	free(queue);
+}
+
+// Inserts the value at the head of the queue. Any number of
+// threads may enqueue at the same time. If the queue is full,
+// insertion will fail, and the function returns false.
+// 
+// A slot is free for position pos when its sequence equals pos.
+// The producer claims pos by advancing the head with a CAS, then
+// publishes the value by setting the sequence to pos+1.
+// 
+// Returns true if insertion was successful.
+bool mpmc_queue_enqueue(mpmc_queue* queue, char value)
+{
+	mpmc_cell* cell;
+	uint32_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	for (;;) {
+		cell = &queue->buffer[MOD2(pos, queue->max)];
+		uint32_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		int32_t diff = (int32_t)(seq - pos);
+
+		if (diff == 0) {
+			// On failure the CAS reloads pos with the current head.
+			if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos+1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			// The slot still holds the value from the previous lap.
+			return false;
+		} else {
+			pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+		}
+	}
+
+	cell->value = value;
+	atomic_store_explicit(&cell->sequence, pos+1, memory_order_release);
+	return true;
+}
+
+// Removes the value at the tail of the queue and stores it in
+// value. Any number of threads may dequeue at the same time.
+// 
+// A slot is ready for position pos when its sequence equals pos+1.
+// The consumer claims pos by advancing the tail with a CAS, then
+// frees the slot for the next lap by setting the sequence to pos+n.
+// 
+// Returns true if a value was removed, or false if the queue is empty.
+bool mpmc_queue_dequeue(mpmc_queue* queue, char* value)
+{
+	mpmc_cell* cell;
+	uint32_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+	for (;;) {
+		cell = &queue->buffer[MOD2(pos, queue->max)];
+		uint32_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		int32_t diff = (int32_t)(seq - (pos+1));
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos, pos+1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			// No producer has published this position yet.
+			return false;
+		} else {
+			pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+		}
+	}
+
+	*value = cell->value;
+	atomic_store_explicit(&cell->sequence, pos + queue->max, memory_order_release);
+	return true;
+}
@@ -0,0 +1,82 @@
+// A lock-free, bounded, multi-producer/multi-consumer queue.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _MPMC_QUEUE_H_
+#define _MPMC_QUEUE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ringbuffer.h"
+
+// A slot of the queue. The sequence number tells producers and
+// consumers whose turn it is to use the slot, so each side only
+// has to claim a position and never has to lock the queue.
+typedef struct _mpmc_cell {
+	_Atomic uint32_t sequence;
+	char value;
+} mpmc_cell;
+
+// The queue keeps no ringbuffer_counters, even with RINGBUFFER_STATS.
+// Producers share one side, so counting would add a contended atomic
+// to every operation.
+typedef struct _mpmc_queue {
+	uint32_t max;                   // max number of elements in the queue
+	mpmc_cell* buffer;              // underlying buffer
+	char pad0[RINGBUFFER_CACHE_LINE];
+	_Atomic uint32_t head;          // input, claimed by producers
+	char pad1[RINGBUFFER_CACHE_LINE];
+	_Atomic uint32_t tail;          // output, claimed by consumers
+	char pad2[RINGBUFFER_CACHE_LINE];
+} mpmc_queue;
+
+// Allocates a new mpmc_queue with space for n elements where
+// n must be a power of 2 and at least 2. Unlike ringbuffer, all
+// n slots are usable since the per-slot sequence numbers tell the
+// full and empty states apart. A single slot cannot, as "ready to
+// read at pos" and "free to write at pos+1" would be the same number.
+// 
+// Returns a pointer to the newly allocated mpmc_queue,
+// or NULL if n is less than 2 or not a power of 2.
+mpmc_queue* new_mpmc_queue(uint32_t n);
+
+// Frees memory used by mpmc_queue. No thread
+// may be using the queue anymore.
+void delete_mpmc_queue(mpmc_queue* queue);
+
+// Inserts the value at the head of the queue. Any number of
+// threads may enqueue at the same time. If the queue is full,
+// insertion will fail, and the function returns false.
+// 
+// Returns true if insertion was successful.
+bool mpmc_queue_enqueue(mpmc_queue* queue, char value);
+
+// Removes the value at the tail of the queue and stores it in
+// value. Any number of threads may dequeue at the same time.
+// 
+// Returns true if a value was removed, or false if the queue is empty.
+bool mpmc_queue_dequeue(mpmc_queue* queue, char* value);
+
+#endif
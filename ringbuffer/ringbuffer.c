@@ -22,17 +22,20 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include "ringbuffer.h"
+// memfd_create is a GNU extension.
+#define _GNU_SOURCE
 
-#if UNIT_TESTING
-	extern void* _test_malloc(const size_t size, const char *file, const int line);
-	extern void _test_free(void* const ptr, const char* file, const int line);
+#include "ringbuffer.h"
+#include "ringbuffer_private.h"
 
-	#define malloc(size) _test_malloc(size, __FILE__, __LINE__)
-	#define free(ptr) _test_free(ptr, __FILE__, __LINE__)
-#endif 
+#ifdef __linux__
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
 
-#define MOD2(a,b)  ((a) & (b-1))
+#if defined(__AVX2__) || defined(__SSE2__)
+	#include <immintrin.h>
+#endif
 
 // Allocates a new ringbuffer with space for n/n-1 elements
 // where n must be a power of 2. If utilizing ringbuffer_sfinsert,
@@ -42,105 +45,266 @@
 // Returns a pointer to the newly allocated ringbuffer.
 ringbuffer* new_ringbuffer(uint32_t n)
 {
-	// First check to make sure n is a power of two.
-	// This works because any power of 2, N, will only have
-	// a single 1 in its binary representation. This single 1 
-	// will be the most signficant bit ignoring leading zeroes. 
-	// N - 1 will be the one's complement. So essentially we 
-	// have N & ~N which is 0. 
-	// 
-	// To prove to yourself that a power of 2 ANDed with 
-	// that power of 2 - 1 is always 0 observe this pattern: 
-	// (2:1, 10:1) (4:3, 100:11) (8:7, 1000:111) (16:15, 10000:1111).
-	if ((n & (n-1)) != 0)
+	if (!ISPOW2(n))
 		return NULL;
 
 	ringbuffer* rbuf = malloc(sizeof(ringbuffer));
 
 	if (rbuf != NULL) {
-		rbuf->max    = n;
-		rbuf->tail   = 0;
-		rbuf->head   = 0;
-		rbuf->buffer = malloc(sizeof(char) * n);
+		rbuf->max      = n;
+		rbuf->tail     = 0;
+		rbuf->head     = 0;
+		rbuf->buffer   = malloc(sizeof(char) * n);
+		rbuf->mirrored = false;
+		RINGBUFFER_STAT(memset(&rbuf->stats, 0, sizeof(rbuf->stats));)
 	}
 	
 	return rbuf;
 }
 
+#ifdef __linux__
+// Maps an anonymous memory file of size bytes twice, back to back.
+// The full range is reserved first so that the second mapping is
+// guaranteed to land right after the first one.
+// 
+// Returns the start of the mapping, or NULL if it failed.
+static char* ringbuffer_map_mirror(size_t size)
+{
+	int fd = memfd_create("ringbuffer", MFD_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	char* base = MAP_FAILED;
+	if (ftruncate(fd, size) == 0)
+		base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (base != MAP_FAILED) {
+		if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+				|| mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(base, 2 * size);
+			base = MAP_FAILED;
+		}
+	}
+
+	// The mappings keep the memory file alive.
+	close(fd);
+	return base == MAP_FAILED ? NULL : base;
+}
+#endif
+
+// Allocates a new ringbuffer like new_ringbuffer, but maps the
+// underlying buffer twice, back to back, in virtual memory. Writing
+// buffer[i] also writes buffer[i+n], so any run of up to n values
+// starting inside the buffer is contiguous in memory, even when it
+// wraps past the end. n must also be a multiple of the page size.
+// Only available on Linux.
+// 
+// Returns a pointer to the newly allocated ringbuffer, or NULL if
+// n is not valid or the buffer could not be mapped.
+ringbuffer* new_mirrored_ringbuffer(uint32_t n)
+{
+#ifdef __linux__
+	if (!ISPOW2(n) || n % sysconf(_SC_PAGESIZE) != 0)
+		return NULL;
+
+	char* buffer = ringbuffer_map_mirror(sizeof(char) * n);
+	if (buffer == NULL)
+		return NULL;
+
+	ringbuffer* rbuf = malloc(sizeof(ringbuffer));
+
+	if (rbuf != NULL) {
+		rbuf->max      = n;
+		rbuf->tail     = 0;
+		rbuf->head     = 0;
+		rbuf->buffer   = buffer;
+		rbuf->mirrored = true;
+		RINGBUFFER_STAT(memset(&rbuf->stats, 0, sizeof(rbuf->stats));)
+	} else {
+		munmap(buffer, 2 * sizeof(char) * n);
+	}
+
+	return rbuf;
+#else
+	return NULL;
+#endif
+}
+
 // Frees memory used by ringbuffer.
 void delete_ringbuffer(ringbuffer* rbuf)
 {
-	free(rbuf->buffer);
+#ifdef __linux__
+	if (rbuf->mirrored)
+		munmap(rbuf->buffer, 2 * sizeof(char) * rbuf->max);
+	else
+#endif
+		free(rbuf->buffer);
 	free(rbuf);
 }
 
-// Inserts the value at the head of the ringbuffer.
-// Does not check if the buffer is full, and will 
-// overwrite any existing values. For a safe insert
-// use ringbuffer_sfinsert(ringbuffer* rbuf, char value).
-void ringbuffer_insert(ringbuffer* rbuf, char value)
+// Generates the remaining functions declared in ringbuffer.h. See
+// ringbuffer_template.h for how each of them is implemented.
+RINGBUFFER_OPERATIONS(ringbuffer, char, )
+
+// Returns a pointer to the values at the tail of the ringbuffer so
+// they can be used in place, and stores how many there are in len.
+// For a mirrored ringbuffer these are all stored values, otherwise
+// only those up to the end of the underlying buffer. Call
+// ringbuffer_consume once done with them.
+char* ringbuffer_read_span(ringbuffer* rbuf, size_t* len)
+{
+	*len = ringbuffer_count(rbuf);
+	if (!rbuf->mirrored && *len > rbuf->max - rbuf->tail)
+		*len = rbuf->max - rbuf->tail;
+	return rbuf->buffer + rbuf->tail;
+}
+
+// Removes n values from the tail of the ringbuffer without copying
+// them. n must not exceed the len returned by ringbuffer_read_span.
+void ringbuffer_consume(ringbuffer* rbuf, size_t n)
+{
+	rbuf->tail = MOD2(rbuf->tail + (uint32_t)n, rbuf->max);
+	RINGBUFFER_STAT(ringbuffer_count_remove(&rbuf->stats, n, n);)
+}
+
+// Returns a pointer to the free space at the head of the ringbuffer
+// so values can be written in place, and stores its size in len.
+// Like ringbuffer_sfinsert, at most n-1 values fit in the buffer.
+// For a mirrored ringbuffer this is all free space, otherwise only
+// the space up to the end of the underlying buffer. Call
+// ringbuffer_commit to make the written values readable.
+char* ringbuffer_write_span(ringbuffer* rbuf, size_t* len)
+{
+	*len = rbuf->max - 1 - ringbuffer_count(rbuf);
+	if (!rbuf->mirrored && *len > rbuf->max - rbuf->head)
+		*len = rbuf->max - rbuf->head;
+	return rbuf->buffer + rbuf->head;
+}
+
+// Inserts n values written through ringbuffer_write_span at the head
+// of the ringbuffer. n must not exceed the len returned by
+// ringbuffer_write_span.
+void ringbuffer_commit(ringbuffer* rbuf, size_t n)
 {
-	uint32_t nextHead = MOD2(rbuf->head+1, rbuf->max);
-	rbuf->buffer[rbuf->head] = value;
-	rbuf->head = nextHead;
+	RINGBUFFER_STAT(uint32_t before = ringbuffer_count(rbuf);)
+	rbuf->head = MOD2(rbuf->head + (uint32_t)n, rbuf->max);
+	RINGBUFFER_STAT(ringbuffer_count_insert(&rbuf->stats, before, n, before + (uint32_t)n);)
 }
 
-// Inserts the value at the head of the ringbuffer.
-// If the buffer is full, insertion will fail,
-// and the function returns false. Utlizing sfinsert
-// limits the usable space of the ringbuffer to n-1.
+// Searches len values starting at p for delim, 32 or 16 at a time
+// when AVX2 or SSE2 is available, then one at a time for the rest.
 // 
-// Returns true if insertion was successful. 
-bool ringbuffer_sfinsert(ringbuffer* rbuf, char value)
+// Returns the index of the first delim, or len if there is none.
+static size_t ringbuffer_scan(const char* p, size_t len, char delim)
 {
-	if (!ringbuffer_isfull(rbuf)) {
-		rbuf->buffer[rbuf->head] = value;
-		rbuf->head = MOD2(rbuf->head+1, rbuf->max);;
-		return true;
-	} else {
-		return false;
+	size_t i = 0;
+
+#ifdef __AVX2__
+	__m256i wide = _mm256_set1_epi8(delim);
+	for (; i + 32 <= len; i += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+#ifdef __SSE2__
+	__m128i narrow = _mm_set1_epi8(delim);
+	for (; i + 16 <= len; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrow));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	for (; i < len; ++i) {
+		if (p[i] == delim)
+			return i;
 	}
+	return len;
 }
 
-// Removes the value at the head of the ringbuffer.
+// Searches the first len stored values for delim, scanning the part
+// up to the end of the underlying buffer and then the wrapped part.
 // 
-// Returns the value removed, or 0 if it failed.
-char ringbuffer_remove(ringbuffer* rbuf)
+// Returns the offset of the first delim from the tail, or len.
+static size_t ringbuffer_search(ringbuffer* rbuf, char delim, size_t len)
 {
-	char item = 0;
-	if (!ringbuffer_isempty(rbuf)) {
-		item = rbuf->buffer[rbuf->tail];
-		rbuf->tail = MOD2(rbuf->tail+1, rbuf->max);;
-	}
-	return item;
+	size_t first = rbuf->max - rbuf->tail;
+	if (first > len)
+		first = len;
+
+	size_t pos = ringbuffer_scan(rbuf->buffer + rbuf->tail, first, delim);
+	if (pos == first && first < len)
+		pos = first + ringbuffer_scan(rbuf->buffer, len - first, delim);
+	return pos;
 }
 
-// Returns the value at the head of the ringbuffer,
-// or 0 when the buffer is empty.
-char ringbuffer_peek(ringbuffer* rbuf)
+// Searches the stored values for delim, starting at the tail. Both
+// parts of wrapped contents are scanned with SSE2 or AVX2 compares
+// when the build targets them, else one value at a time.
+// 
+// Returns the offset of the first delim from the tail, or
+// RINGBUFFER_NOT_FOUND if no stored value equals delim.
+size_t ringbuffer_find(ringbuffer* rbuf, char delim)
 {
-	char item = 0;
-	if (!ringbuffer_isempty(rbuf)) 
-		item = rbuf->buffer[rbuf->tail];
-	return item;
+	size_t count = ringbuffer_count(rbuf);
+	size_t pos = ringbuffer_search(rbuf, delim, count);
+	return pos < count ? pos : RINGBUFFER_NOT_FOUND;
 }
 
-// Checks if the ringbuffer instance is empty.
-// The buffer is defined as empty if the head is
-// equal to the tail.
+// Removes the values up to and including the first delim and copies
+// them into dst, if delim is among the first cap stored values. When
+// cap values are stored without a delim among them, those are read
+// instead, so a record longer than cap can be read in pieces. Check
+// whether the last value read is delim to tell the cases apart.
 // 
-// Returns true if it is empty, else it returns false.
-bool ringbuffer_isempty(ringbuffer* rbuf) 
+// Returns the number of values read, or 0 if fewer than cap values
+// are stored and none of them is delim.
+size_t ringbuffer_read_until(ringbuffer* rbuf, char delim, char* dst, size_t cap)
+{
+	size_t count = ringbuffer_count(rbuf);
+	size_t len = count < cap ? count : cap;
+	size_t pos = ringbuffer_search(rbuf, delim, len);
+
+	if (pos < len)
+		len = pos + 1;
+	else if (len < cap)
+		return 0;
+	return ringbuffer_read(rbuf, dst, len);
+}
+
+// Returns the length of the longest record ringbuffer_read_frame can
+// read, which is the capacity of the ringbuffer less the 4 byte prefix.
+size_t ringbuffer_frame_limit(ringbuffer* rbuf)
 {
-	return rbuf->head == rbuf->tail;
+	return rbuf->max > 5 ? rbuf->max - 5 : 0;
 }
 
-// Checks if the ringbuffer instance is full.
-// The buffer is defined as full if the head + 1
-// element is equal to the tail. 
+// Removes one record that is prefixed with its length as a 4 byte
+// big endian integer and copies the record, without the prefix, into
+// dst. Nothing is removed until the whole record is stored.
 // 
-// Returns true if it is full, else it returns false.
-bool ringbuffer_isfull(ringbuffer* rbuf) 
+// Returns true if a record was read, and stores its length in len.
+// Returns false if the record is not complete yet or is longer than
+// cap, and stores the length from the prefix in len, or 0 if the
+// prefix itself is not complete. A record longer than cap or than
+// ringbuffer_frame_limit can never be read, so a len above either
+// means the stream cannot continue and must be treated as an error.
+bool ringbuffer_read_frame(ringbuffer* rbuf, char* dst, size_t cap, size_t* len)
 {
-	return MOD2(rbuf->head+1, rbuf->max) == rbuf->tail;
-}
\ No newline at end of file
+	unsigned char prefix[4];
+
+	*len = 0;
+	if (ringbuffer_peekn(rbuf, (char*)prefix, sizeof(prefix)) < sizeof(prefix))
+		return false;
+
+	*len = (size_t)prefix[0] << 24 | (size_t)prefix[1] << 16
+		| (size_t)prefix[2] << 8 | (size_t)prefix[3];
+	if (*len > cap || ringbuffer_count(rbuf) - sizeof(prefix) < *len)
+		return false;
+
+	ringbuffer_read(rbuf, (char*)prefix, sizeof(prefix));
+	ringbuffer_read(rbuf, dst, *len);
+	return true;
+}
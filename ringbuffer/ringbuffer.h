@@ -28,12 +28,27 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "ringbuffer_template.h"
 
+// Size of a cache line on the targeted hardware. Indices
+// written by different threads in the concurrent variants
+// are kept at least this far apart so the threads never
+// false-share a line.
+#define RINGBUFFER_CACHE_LINE 64
+
+// Returned by ringbuffer_find when the delimiter is not stored.
+#define RINGBUFFER_NOT_FOUND ((size_t)-1)
+
+// The char ring buffer is an instance of the templates in
+// ringbuffer_template.h. Its operations are generated in ringbuffer.c,
+// next to allocators that also support a mirrored buffer.
 typedef struct _ringbuffer {
 	uint32_t max;     // max number of elements in the buffer
 	uint32_t head;    // input
 	uint32_t tail;    // output
 	char* buffer;     // underlying buffer
+	bool mirrored;    // buffer is mapped twice, back to back
+	RINGBUFFER_STAT(ringbuffer_counters stats;)
 } ringbuffer;
 
 // Allocates a new ringbuffer with space for n/n-1 elements
@@ -44,6 +59,17 @@ typedef struct _ringbuffer {
 // Returns a pointer to the newly allocated ringbuffer.
 ringbuffer* new_ringbuffer(uint32_t n);
 
+// Allocates a new ringbuffer like new_ringbuffer, but maps the
+// underlying buffer twice, back to back, in virtual memory. Writing
+// buffer[i] also writes buffer[i+n], so any run of up to n values
+// starting inside the buffer is contiguous in memory, even when it
+// wraps past the end. n must also be a multiple of the page size.
+// Only available on Linux.
+// 
+// Returns a pointer to the newly allocated ringbuffer, or NULL if
+// n is not valid or the buffer could not be mapped.
+ringbuffer* new_mirrored_ringbuffer(uint32_t n);
+
 // Frees memory used by ringbuffer.
 void delete_ringbuffer(ringbuffer* rbuf);
 
@@ -70,6 +96,99 @@ char ringbuffer_remove(ringbuffer* rbuf);
 // or 0 when the buffer is empty.
 char ringbuffer_peek(ringbuffer* rbuf);
 
+// Copies len values from src into the ringbuffer, starting
+// at the head. Like ringbuffer_insert, this does not check if
+// the buffer is full and will overwrite any existing values.
+// If len exceeds the size of the buffer only the last n values
+// of src remain stored.
+// 
+// Returns the number of values written, which is always len.
+size_t ringbuffer_write(ringbuffer* rbuf, const char* src, size_t len);
+
+// Copies up to len values from src into the ringbuffer, starting
+// at the head. Like ringbuffer_sfinsert, values are only written
+// while the buffer is not full, so at most n-1 values can be stored.
+// 
+// Returns the number of values written, which may be less than len.
+size_t ringbuffer_sfwrite(ringbuffer* rbuf, const char* src, size_t len);
+
+// Removes up to len values from the tail of the ringbuffer
+// and copies them into dst.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t ringbuffer_read(ringbuffer* rbuf, char* dst, size_t len);
+
+// Copies up to len values from the tail of the ringbuffer into
+// dst without removing them.
+// 
+// Returns the number of values copied, or 0 if the buffer is empty.
+size_t ringbuffer_peekn(ringbuffer* rbuf, char* dst, size_t len);
+
+// Returns the number of values currently stored in the ringbuffer.
+uint32_t ringbuffer_count(ringbuffer* rbuf);
+
+// Returns a pointer to the values at the tail of the ringbuffer so
+// they can be used in place, and stores how many there are in len.
+// For a mirrored ringbuffer these are all stored values, otherwise
+// only those up to the end of the underlying buffer. Call
+// ringbuffer_consume once done with them.
+char* ringbuffer_read_span(ringbuffer* rbuf, size_t* len);
+
+// Removes n values from the tail of the ringbuffer without copying
+// them. n must not exceed the len returned by ringbuffer_read_span.
+void ringbuffer_consume(ringbuffer* rbuf, size_t n);
+
+// Returns a pointer to the free space at the head of the ringbuffer
+// so values can be written in place, and stores its size in len.
+// Like ringbuffer_sfinsert, at most n-1 values fit in the buffer.
+// For a mirrored ringbuffer this is all free space, otherwise only
+// the space up to the end of the underlying buffer. Call
+// ringbuffer_commit to make the written values readable.
+char* ringbuffer_write_span(ringbuffer* rbuf, size_t* len);
+
+// Inserts n values written through ringbuffer_write_span at the head
+// of the ringbuffer. n must not exceed the len returned by
+// ringbuffer_write_span.
+void ringbuffer_commit(ringbuffer* rbuf, size_t n);
+
+// Searches the stored values for delim, starting at the tail. Both
+// parts of wrapped contents are scanned with SSE2 or AVX2 compares
+// when the build targets them, else one value at a time.
+// 
+// Returns the offset of the first delim from the tail, or
+// RINGBUFFER_NOT_FOUND if no stored value equals delim.
+size_t ringbuffer_find(ringbuffer* rbuf, char delim);
+
+// Removes the values up to and including the first delim and copies
+// them into dst, if delim is among the first cap stored values. When
+// cap values are stored without a delim among them, those are read
+// instead, so a record longer than cap can be read in pieces. Check
+// whether the last value read is delim to tell the cases apart.
+// 
+// Returns the number of values read, or 0 if fewer than cap values
+// are stored and none of them is delim.
+size_t ringbuffer_read_until(ringbuffer* rbuf, char delim, char* dst, size_t cap);
+
+// Returns the length of the longest record ringbuffer_read_frame can
+// read, which is the capacity of the ringbuffer less the 4 byte prefix.
+size_t ringbuffer_frame_limit(ringbuffer* rbuf);
+
+// Removes one record that is prefixed with its length as a 4 byte
+// big endian integer and copies the record, without the prefix, into
+// dst. Nothing is removed until the whole record is stored.
+// 
+// Returns true if a record was read, and stores its length in len.
+// Returns false if the record is not complete yet or is longer than
+// cap, and stores the length from the prefix in len, or 0 if the
+// prefix itself is not complete. A record longer than cap or than
+// ringbuffer_frame_limit can never be read, so a len above either
+// means the stream cannot continue and must be treated as an error.
+bool ringbuffer_read_frame(ringbuffer* rbuf, char* dst, size_t cap, size_t* len);
+
+// Returns a snapshot of the counters of the ringbuffer, or all
+// zeros when built without RINGBUFFER_STATS.
+ringbuffer_counters ringbuffer_stats(ringbuffer* rbuf);
+
 // Checks if the ringbuffer instance is empty.
 // The buffer is defined as empty if the head is
 // equal to the tail.
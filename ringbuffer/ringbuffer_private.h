@@ -0,0 +1,52 @@
+// Helpers shared by the ringbuffer implementations.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _RINGBUFFER_PRIVATE_H_
+#define _RINGBUFFER_PRIVATE_H_
+
+#include "ringbuffer_template.h"
+
+#if UNIT_TESTING
+	extern void* _test_malloc(const size_t size, const char *file, const int line);
+	extern void _test_free(void* const ptr, const char* file, const int line);
+
+	#define malloc(size) _test_malloc(size, __FILE__, __LINE__)
+	#define free(ptr) _test_free(ptr, __FILE__, __LINE__)
+#endif 
+
+#define MOD2(a,b)  RINGBUFFER_MOD2(a,b)
+#define ISPOW2(n)  RINGBUFFER_ISPOW2(n)
+
+// Adds n to an atomic counter that only one thread writes. A plain
+// load and store is enough then, and avoids a locked instruction.
+#define STAT_ADD(counter, n) atomic_store_explicit(&(counter), \
+	atomic_load_explicit(&(counter), memory_order_relaxed) + (n), memory_order_relaxed)
+
+// Raises an atomic high-water mark that only one thread writes.
+#define STAT_MAX(counter, n) do { \
+		if ((n) > atomic_load_explicit(&(counter), memory_order_relaxed)) \
+			atomic_store_explicit(&(counter), (n), memory_order_relaxed); \
+	} while (0)
+
+#endif
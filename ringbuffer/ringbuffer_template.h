@@ -0,0 +1,333 @@
+// Macro templates that generate a ring buffer for any element type.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _RINGBUFFER_TEMPLATE_H_
+#define _RINGBUFFER_TEMPLATE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// RINGBUFFER_DEFINE(name, T) generates, as static inline functions,
+// a ring buffer type called name that stores values of type T:
+// 
+//   name* new_name(uint32_t n);
+//   void delete_name(name* rbuf);
+//   void name_insert(name* rbuf, T value);
+//   bool name_sfinsert(name* rbuf, T value);
+//   T name_remove(name* rbuf);
+//   T name_peek(name* rbuf);
+//   size_t name_write(name* rbuf, const T* src, size_t len);
+//   size_t name_sfwrite(name* rbuf, const T* src, size_t len);
+//   size_t name_read(name* rbuf, T* dst, size_t len);
+//   size_t name_peekn(name* rbuf, T* dst, size_t len);
+//   uint32_t name_count(name* rbuf);
+//   bool name_isempty(name* rbuf);
+//   bool name_isfull(name* rbuf);
+//   ringbuffer_counters name_stats(name* rbuf);
+// 
+// They behave exactly like the ringbuffer functions of the same
+// name, with remove and peek returning a zeroed T on failure.
+// Since sizeof(T) is known at compile time, the compiler can
+// inline the functions and turn the copies into plain moves.
+// 
+// To share one instance between several translation units, put
+// RINGBUFFER_DECLARE(name, T) in a header and RINGBUFFER_IMPLEMENT(name, T)
+// in a single source file instead. The char ringbuffer in ringbuffer.c
+// only generates its operations, since it has its own allocators.
+// 
+// For example:
+// 
+//   RINGBUFFER_DEFINE(u64_ringbuffer, uint64_t)
+// 
+//   u64_ringbuffer* rbuf = new_u64_ringbuffer(1024);
+//   u64_ringbuffer_sfinsert(rbuf, timestamp);
+
+#define RINGBUFFER_MOD2(a,b)  ((a) & (b-1))
+
+// Checks that n is a power of two.
+// This works because any power of 2, N, will only have
+// a single 1 in its binary representation. This single 1 
+// will be the most signficant bit ignoring leading zeroes. 
+// N - 1 will be the one's complement. So essentially we 
+// have N & ~N which is 0. 
+// 
+// To prove to yourself that a power of 2 ANDed with 
+// that power of 2 - 1 is always 0 observe this pattern: 
+// (2:1, 10:1) (4:3, 100:11) (8:7, 1000:111) (16:15, 10000:1111).
+#define RINGBUFFER_ISPOW2(n)  (((n) & ((n)-1)) == 0)
+
+// Counters kept by a ring buffer when RINGBUFFER_STATS is defined.
+// Without it, the counting code compiles away and the stats calls
+// return all zeros. RINGBUFFER_STATS changes the layout of the ring
+// buffer structs, so it must be the same for all translation units.
+// Only ringbuffer, the template instances and spsc_ringbuffer keep
+// them; mpmc_queue, shm_ringbuffer, bcast_ringbuffer and
+// grow_ringbuffer do not.
+typedef struct _ringbuffer_counters {
+	uint64_t inserts;         // values inserted
+	uint64_t removes;         // values removed
+	uint64_t rejected;        // insert attempts that found the buffer full
+	uint64_t overwritten;     // stored values lost to an overwriting insert
+	uint64_t empty_removes;   // remove attempts that found the buffer empty
+	uint32_t high_water;      // most values stored at once
+} ringbuffer_counters;
+
+// Expands to its arguments only when RINGBUFFER_STATS is defined.
+#ifdef RINGBUFFER_STATS
+	#define RINGBUFFER_STAT(...) __VA_ARGS__
+#else
+	#define RINGBUFFER_STAT(...)
+#endif
+
+#ifdef RINGBUFFER_STATS
+// Counts len values inserted into a buffer that held before values
+// and holds after values now. Overwriting inserts never fail, but
+// wrap around and lose whatever was stored when the buffer fills.
+static inline void ringbuffer_count_insert(ringbuffer_counters* stats,
+	uint32_t before, size_t len, uint32_t after)
+{
+	stats->inserts += len;
+	stats->overwritten += before + len - after;
+	if (after > stats->high_water)
+		stats->high_water = after;
+}
+
+// Counts len values removed after asking for want values.
+static inline void ringbuffer_count_remove(ringbuffer_counters* stats, size_t want, size_t len)
+{
+	stats->removes += len;
+	stats->empty_removes += len == 0 && want > 0;
+}
+#endif
+
+// Generates the ring buffer type.
+#define RINGBUFFER_STRUCT(name, T) \
+	typedef struct _##name { \
+		uint32_t max;     /* max number of elements in the buffer */ \
+		uint32_t head;    /* input */ \
+		uint32_t tail;    /* output */ \
+		T* buffer;        /* underlying buffer */ \
+		RINGBUFFER_STAT(ringbuffer_counters stats;) \
+	} name;
+
+// Generates the function prototypes, each prefixed with scope.
+#define RINGBUFFER_PROTOTYPES(name, T, scope) \
+	scope name* new_##name(uint32_t n); \
+	scope void delete_##name(name* rbuf); \
+	scope void name##_insert(name* rbuf, T value); \
+	scope bool name##_sfinsert(name* rbuf, T value); \
+	scope T name##_remove(name* rbuf); \
+	scope T name##_peek(name* rbuf); \
+	scope size_t name##_write(name* rbuf, const T* src, size_t len); \
+	scope size_t name##_sfwrite(name* rbuf, const T* src, size_t len); \
+	scope size_t name##_read(name* rbuf, T* dst, size_t len); \
+	scope size_t name##_peekn(name* rbuf, T* dst, size_t len); \
+	scope uint32_t name##_count(name* rbuf); \
+	scope bool name##_isempty(name* rbuf); \
+	scope bool name##_isfull(name* rbuf); \
+	scope ringbuffer_counters name##_stats(name* rbuf);
+
+// Generates new_name and delete_name, each prefixed with scope.
+#define RINGBUFFER_ALLOCATORS(name, T, scope) \
+	scope name* new_##name(uint32_t n) \
+	{ \
+		if (!RINGBUFFER_ISPOW2(n)) \
+			return NULL; \
+		name* rbuf = malloc(sizeof(name)); \
+		if (rbuf != NULL) { \
+			rbuf->max    = n; \
+			rbuf->tail   = 0; \
+			rbuf->head   = 0; \
+			rbuf->buffer = malloc(sizeof(T) * n); \
+			RINGBUFFER_STAT(memset(&rbuf->stats, 0, sizeof(rbuf->stats));) \
+		} \
+		return rbuf; \
+	} \
+	\
+	scope void delete_##name(name* rbuf) \
+	{ \
+		free(rbuf->buffer); \
+		free(rbuf); \
+	}
+
+// Generates the definitions of all other functions, each prefixed
+// with scope. They only use the max, head, tail and buffer members
+// of the struct. The copy helpers split a copy around the wrap point
+// so that at most two memcpy calls are needed. name_write skips
+// values that would be overwritten within the same call.
+#define RINGBUFFER_OPERATIONS(name, T, scope) \
+	scope void name##_insert(name* rbuf, T value) \
+	{ \
+		RINGBUFFER_STAT(uint32_t before = name##_count(rbuf);) \
+		uint32_t nextHead = RINGBUFFER_MOD2(rbuf->head+1, rbuf->max); \
+		rbuf->buffer[rbuf->head] = value; \
+		rbuf->head = nextHead; \
+		RINGBUFFER_STAT(ringbuffer_count_insert(&rbuf->stats, before, 1, name##_count(rbuf));) \
+	} \
+	\
+	scope bool name##_sfinsert(name* rbuf, T value) \
+	{ \
+		if (!name##_isfull(rbuf)) { \
+			RINGBUFFER_STAT(uint32_t before = name##_count(rbuf);) \
+			rbuf->buffer[rbuf->head] = value; \
+			rbuf->head = RINGBUFFER_MOD2(rbuf->head+1, rbuf->max); \
+			RINGBUFFER_STAT(ringbuffer_count_insert(&rbuf->stats, before, 1, before + 1);) \
+			return true; \
+		} else { \
+			RINGBUFFER_STAT(rbuf->stats.rejected++;) \
+			return false; \
+		} \
+	} \
+	\
+	scope T name##_remove(name* rbuf) \
+	{ \
+		T item = {0}; \
+		if (!name##_isempty(rbuf)) { \
+			item = rbuf->buffer[rbuf->tail]; \
+			rbuf->tail = RINGBUFFER_MOD2(rbuf->tail+1, rbuf->max); \
+			RINGBUFFER_STAT(rbuf->stats.removes++;) \
+		} else { \
+			RINGBUFFER_STAT(rbuf->stats.empty_removes++;) \
+		} \
+		return item; \
+	} \
+	\
+	scope T name##_peek(name* rbuf) \
+	{ \
+		T item = {0}; \
+		if (!name##_isempty(rbuf)) \
+			item = rbuf->buffer[rbuf->tail]; \
+		return item; \
+	} \
+	\
+	static inline void name##_copyin(name* rbuf, uint32_t pos, const T* src, uint32_t len) \
+	{ \
+		uint32_t first = rbuf->max - pos; \
+		if (first > len) \
+			first = len; \
+		memcpy(rbuf->buffer + pos, src, sizeof(T) * first); \
+		memcpy(rbuf->buffer, src + first, sizeof(T) * (len - first)); \
+	} \
+	\
+	static inline void name##_copyout(name* rbuf, uint32_t pos, T* dst, uint32_t len) \
+	{ \
+		uint32_t first = rbuf->max - pos; \
+		if (first > len) \
+			first = len; \
+		memcpy(dst, rbuf->buffer + pos, sizeof(T) * first); \
+		memcpy(dst + first, rbuf->buffer, sizeof(T) * (len - first)); \
+	} \
+	\
+	scope size_t name##_write(name* rbuf, const T* src, size_t len) \
+	{ \
+		RINGBUFFER_STAT(uint32_t before = name##_count(rbuf);) \
+		size_t skip = 0; \
+		if (len > rbuf->max) { \
+			skip = len - rbuf->max; \
+			rbuf->head = RINGBUFFER_MOD2(rbuf->head + (uint32_t)skip, rbuf->max); \
+		} \
+		name##_copyin(rbuf, rbuf->head, src + skip, (uint32_t)(len - skip)); \
+		rbuf->head = RINGBUFFER_MOD2(rbuf->head + (uint32_t)(len - skip), rbuf->max); \
+		RINGBUFFER_STAT(ringbuffer_count_insert(&rbuf->stats, before, len, name##_count(rbuf));) \
+		return len; \
+	} \
+	\
+	scope size_t name##_sfwrite(name* rbuf, const T* src, size_t len) \
+	{ \
+		uint32_t space = rbuf->max - 1 - name##_count(rbuf); \
+		RINGBUFFER_STAT(rbuf->stats.rejected += len > space ? len - space : 0;) \
+		if (len > space) \
+			len = space; \
+		name##_copyin(rbuf, rbuf->head, src, (uint32_t)len); \
+		rbuf->head = RINGBUFFER_MOD2(rbuf->head + (uint32_t)len, rbuf->max); \
+		RINGBUFFER_STAT(uint32_t before = rbuf->max - 1 - space;) \
+		RINGBUFFER_STAT(ringbuffer_count_insert(&rbuf->stats, before, len, before + (uint32_t)len);) \
+		return len; \
+	} \
+	\
+	scope size_t name##_read(name* rbuf, T* dst, size_t len) \
+	{ \
+		RINGBUFFER_STAT(size_t want = len;) \
+		len = name##_peekn(rbuf, dst, len); \
+		rbuf->tail = RINGBUFFER_MOD2(rbuf->tail + (uint32_t)len, rbuf->max); \
+		RINGBUFFER_STAT(ringbuffer_count_remove(&rbuf->stats, want, len);) \
+		return len; \
+	} \
+	\
+	scope size_t name##_peekn(name* rbuf, T* dst, size_t len) \
+	{ \
+		uint32_t count = name##_count(rbuf); \
+		if (len > count) \
+			len = count; \
+		name##_copyout(rbuf, rbuf->tail, dst, (uint32_t)len); \
+		return len; \
+	} \
+	\
+	scope uint32_t name##_count(name* rbuf) \
+	{ \
+		return RINGBUFFER_MOD2(rbuf->head - rbuf->tail, rbuf->max); \
+	} \
+	\
+	scope bool name##_isempty(name* rbuf) \
+	{ \
+		return rbuf->head == rbuf->tail; \
+	} \
+	\
+	scope bool name##_isfull(name* rbuf) \
+	{ \
+		return RINGBUFFER_MOD2(rbuf->head+1, rbuf->max) == rbuf->tail; \
+	} \
+	\
+	scope ringbuffer_counters name##_stats(name* rbuf) \
+	{ \
+		ringbuffer_counters stats = {0}; \
+		(void)rbuf; \
+		RINGBUFFER_STAT(stats = rbuf->stats;) \
+		return stats; \
+	}
+
+// Generates all function definitions, each prefixed with scope.
+#define RINGBUFFER_FUNCTIONS(name, T, scope) \
+	RINGBUFFER_ALLOCATORS(name, T, scope) \
+	RINGBUFFER_OPERATIONS(name, T, scope)
+
+// Generates a header-only ring buffer with static inline functions.
+#define RINGBUFFER_DEFINE(name, T) \
+	RINGBUFFER_STRUCT(name, T) \
+	RINGBUFFER_PROTOTYPES(name, T, static inline) \
+	RINGBUFFER_FUNCTIONS(name, T, static inline)
+
+// Declares a ring buffer whose functions are defined in
+// a single source file with RINGBUFFER_IMPLEMENT.
+#define RINGBUFFER_DECLARE(name, T) \
+	RINGBUFFER_STRUCT(name, T) \
+	RINGBUFFER_PROTOTYPES(name, T, extern)
+
+// Defines the functions of a ring buffer declared with RINGBUFFER_DECLARE.
+#define RINGBUFFER_IMPLEMENT(name, T) \
+	RINGBUFFER_FUNCTIONS(name, T, )
+
+#endif
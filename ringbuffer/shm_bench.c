@@ -0,0 +1,255 @@
+// Two-process throughput and latency benchmark for shm_ringbuffer.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Forks a second process and measures, for shm_ringbuffer and for a
+// pipe as the baseline:
+//   - throughput, streaming messages from the parent to the child
+//   - latency, as half the round trip of a message echoed back by
+//     the child over a second channel
+// One CSV row is printed per run.
+// 
+// Usage: shm_bench [messages] [message size]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "shm_ringbuffer.h"
+
+#define QUEUE_SIZE (1 << 16)
+#define MAX_MESSAGE_SIZE 4096
+
+// One direction of a channel between the two processes.
+typedef struct _channel {
+	shm_ringbuffer* rbuf;   // set for shm_ringbuffer
+	int fd;                 // set for a pipe
+	pid_t peer;             // process on the other end, or 0 to not watch it
+} channel;
+
+// The segments created by the parent, removed if the child dies.
+static shm_ringbuffer* created[2];
+
+// Unlike a pipe, a shm_ringbuffer does not tell a process that the
+// other end is gone, so the parent checks on the child while it spins.
+// The child may have written its last bytes just before exiting, so
+// the caller gives up only if the channel is still stuck after that.
+// 
+// Returns true once the process on the other end has exited.
+static bool channel_peer_gone(channel* ch, bool gone)
+{
+	if (gone) {
+		fprintf(stderr, "the other process exited\n");
+		for (int i = 0; i < 2; ++i)
+			if (created[i] != NULL)
+				delete_shm_ringbuffer(created[i]);
+		exit(1);
+	}
+	return ch->peer != 0 && waitpid(ch->peer, NULL, WNOHANG) == ch->peer;
+}
+
+// Sends len bytes, spinning while the channel is full.
+static void channel_send(channel* ch, const char* src, size_t len)
+{
+	bool gone = false;
+
+	while (len > 0) {
+		ssize_t written;
+		if (ch->rbuf != NULL)
+			written = shm_ringbuffer_write(ch->rbuf, src, len);
+		else
+			written = write(ch->fd, src, len);
+
+		if (written <= 0) {
+			gone = channel_peer_gone(ch, gone);
+			sched_yield();
+			continue;
+		}
+		src += written;
+		len -= written;
+	}
+}
+
+// Receives exactly len bytes, spinning while the channel is empty.
+static void channel_recv(channel* ch, char* dst, size_t len)
+{
+	bool gone = false;
+
+	while (len > 0) {
+		ssize_t got;
+		if (ch->rbuf != NULL) {
+			got = shm_ringbuffer_read(ch->rbuf, dst, len);
+		} else {
+			got = read(ch->fd, dst, len);
+			// The pipes block, so this is end of file or an error.
+			if (got <= 0) {
+				fprintf(stderr, "the other process closed the pipe\n");
+				exit(1);
+			}
+		}
+
+		if (got <= 0) {
+			gone = channel_peer_gone(ch, gone);
+			sched_yield();
+			continue;
+		}
+		dst += got;
+		len -= got;
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Opens the two channels between parent and child. The shm
+// segments are created by the parent before the fork, and the
+// child attaches to them by name like an unrelated process would.
+// chans[0] and chans[1] are the parent's ends of the forward and
+// backward channels, chans[2] and chans[3] the child's.
+static void open_channels(bool shm, char names[2][64], channel chans[4])
+{
+	int fwd[2], back[2];
+
+	for (int i = 0; i < 4; ++i) {
+		chans[i].rbuf = NULL;
+		chans[i].peer = 0;
+	}
+
+	if (shm) {
+		chans[0].rbuf = new_shm_ringbuffer(names[0], QUEUE_SIZE);
+		chans[1].rbuf = new_shm_ringbuffer(names[1], QUEUE_SIZE);
+		if (chans[0].rbuf == NULL || chans[1].rbuf == NULL) {
+			fprintf(stderr, "failed to create the shm_ringbuffers\n");
+			exit(1);
+		}
+		created[0] = chans[0].rbuf;
+		created[1] = chans[1].rbuf;
+	} else {
+		if (pipe(fwd) != 0 || pipe(back) != 0) {
+			fprintf(stderr, "failed to create the pipes\n");
+			exit(1);
+		}
+		chans[0].fd = fwd[1];
+		chans[1].fd = back[0];
+		chans[2].fd = fwd[0];
+		chans[3].fd = back[1];
+	}
+}
+
+static void bench(bool shm, bool latency, size_t messages, size_t size)
+{
+	char message[MAX_MESSAGE_SIZE];
+	char names[2][64];
+	channel chans[4];
+
+	snprintf(names[0], sizeof(names[0]), "/shm_bench_fwd_%d", (int)getpid());
+	snprintf(names[1], sizeof(names[1]), "/shm_bench_back_%d", (int)getpid());
+	memset(message, 'x', sizeof(message));
+	open_channels(shm, names, chans);
+
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		if (shm) {
+			chans[2].rbuf = open_shm_ringbuffer(names[0]);
+			chans[3].rbuf = open_shm_ringbuffer(names[1]);
+			if (chans[2].rbuf == NULL || chans[3].rbuf == NULL) {
+				fprintf(stderr, "failed to attach to the shm_ringbuffers\n");
+				_exit(1);
+			}
+		} else {
+			close(chans[0].fd);
+			close(chans[1].fd);
+		}
+		for (size_t i = 0; i < messages; ++i) {
+			channel_recv(&chans[2], message, size);
+			if (latency)
+				channel_send(&chans[3], message, size);
+		}
+		// Signal the parent that the last message arrived.
+		if (!latency)
+			channel_send(&chans[3], message, 1);
+		_exit(0);
+	}
+
+	// Close the child's ends, so either process sees end of file
+	// if the other one dies.
+	if (!shm) {
+		close(chans[2].fd);
+		close(chans[3].fd);
+	}
+	chans[0].peer = pid;
+	chans[1].peer = pid;
+
+	double start = now();
+	for (size_t i = 0; i < messages; ++i) {
+		channel_send(&chans[0], message, size);
+		if (latency)
+			channel_recv(&chans[1], message, size);
+	}
+	if (!latency)
+		channel_recv(&chans[1], message, 1);
+	double elapsed = now() - start;
+
+	waitpid(pid, NULL, 0);
+	for (int i = 0; i < 2; ++i) {
+		if (shm) {
+			delete_shm_ringbuffer(chans[i].rbuf);
+			created[i] = NULL;
+		} else
+			close(chans[i].fd);
+	}
+
+	printf("%s,%s,%zu,%zu,%.6f,%.3f,%.3f\n", shm ? "shm_ringbuffer" : "pipe",
+		latency ? "latency" : "throughput", size, messages, elapsed,
+		messages * size * (latency ? 2 : 1) / elapsed / 1e6,
+		elapsed / messages / (latency ? 2 : 1) * 1e6);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	size_t messages = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+	size_t size = argc > 2 ? strtoull(argv[2], NULL, 10) : 64;
+
+	if (size == 0 || size > MAX_MESSAGE_SIZE) {
+		fprintf(stderr, "message size must be between 1 and %d\n", MAX_MESSAGE_SIZE);
+		return 1;
+	}
+
+	printf("transport,test,message_size,messages,seconds,mb_per_sec,usec_per_message\n");
+	for (int latency = 0; latency < 2; ++latency) {
+		bench(true, latency, messages, size);
+		bench(false, latency, messages, size);
+	}
+	return 0;
+}
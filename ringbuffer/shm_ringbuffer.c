@@ -0,0 +1,260 @@
+// A single-producer/single-consumer ring buffer in POSIX shared memory.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// shm_open, ftruncate and mmap are POSIX, not C11.
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "shm_ringbuffer.h"
+#include "ringbuffer_private.h"
+
+_Static_assert(sizeof(shm_ringbuffer_header) == 3 * RINGBUFFER_CACHE_LINE,
+	"the shared header layout must not depend on the compiler");
+
+// Maps the segment open on fd and allocates a handle for it.
+// 
+// Returns the handle, or NULL if it failed.
+static shm_ringbuffer* shm_ringbuffer_map(int fd, size_t size)
+{
+	void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	shm_ringbuffer* rbuf = malloc(sizeof(shm_ringbuffer));
+
+	if (rbuf != NULL) {
+		rbuf->header      = base;
+		rbuf->buffer      = (char*)base + sizeof(shm_ringbuffer_header);
+		rbuf->max         = (uint32_t)(size - sizeof(shm_ringbuffer_header));
+		rbuf->cached_head = 0;
+		rbuf->cached_tail = 0;
+		rbuf->name        = NULL;
+	} else {
+		munmap(base, size);
+	}
+
+	return rbuf;
+}
+
+// Creates a new shared memory segment called name, which must
+// start with a '/' and must not exist yet, holding a ringbuffer
+// with space for n-1 elements where n must be a power of 2.
+// The segment is removed again by delete_shm_ringbuffer.
+// 
+// Returns a handle to the ringbuffer, or NULL if it failed.
+shm_ringbuffer* new_shm_ringbuffer(const char* name, uint32_t n)
+{
+	if (n == 0 || !ISPOW2(n))
+		return NULL;
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return NULL;
+
+	size_t size = sizeof(shm_ringbuffer_header) + sizeof(char) * n;
+	shm_ringbuffer* rbuf = NULL;
+	if (ftruncate(fd, size) == 0)
+		rbuf = shm_ringbuffer_map(fd, size);
+	close(fd);
+
+	if (rbuf != NULL)
+		rbuf->name = malloc(strlen(name) + 1);
+
+	if (rbuf == NULL || rbuf->name == NULL) {
+		if (rbuf != NULL)
+			delete_shm_ringbuffer(rbuf);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	strcpy(rbuf->name, name);
+	rbuf->header->max = n;
+	atomic_init(&rbuf->header->head, 0);
+	atomic_init(&rbuf->header->tail, 0);
+	atomic_store_explicit(&rbuf->header->magic, SHM_RINGBUFFER_MAGIC, memory_order_release);
+
+	return rbuf;
+}
+
+// Attaches to the ringbuffer in the existing shared memory
+// segment called name, created by new_shm_ringbuffer in this
+// or another process.
+// 
+// Returns a handle to the ringbuffer, or NULL if it failed.
+shm_ringbuffer* open_shm_ringbuffer(const char* name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	shm_ringbuffer* rbuf = NULL;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size > sizeof(shm_ringbuffer_header))
+		rbuf = shm_ringbuffer_map(fd, st.st_size);
+	close(fd);
+
+	// The size of the segment must match the header written by the
+	// creator, or one of the processes would index out of bounds.
+	if (rbuf != NULL && (atomic_load_explicit(&rbuf->header->magic, memory_order_acquire)
+			!= SHM_RINGBUFFER_MAGIC || rbuf->header->max != rbuf->max)) {
+		delete_shm_ringbuffer(rbuf);
+		rbuf = NULL;
+	}
+
+	// The indices may have moved since the segment was created, so
+	// start from the current view of both sides.
+	if (rbuf != NULL) {
+		rbuf->cached_head = atomic_load_explicit(&rbuf->header->head, memory_order_acquire);
+		rbuf->cached_tail = atomic_load_explicit(&rbuf->header->tail, memory_order_acquire);
+	}
+
+	return rbuf;
+}
+
+// Unmaps the ringbuffer and frees the handle. If the handle was
+// returned by new_shm_ringbuffer, the segment is removed as well,
+// though processes that are still attached can keep using it.
+void delete_shm_ringbuffer(shm_ringbuffer* rbuf)
+{
+	if (rbuf->name != NULL) {
+		shm_unlink(rbuf->name);
+		free(rbuf->name);
+	}
+	munmap(rbuf->header, sizeof(shm_ringbuffer_header) + sizeof(char) * rbuf->max);
+	free(rbuf);
+}
+
+// Returns the number of free slots as seen by the producer. The
+// shared tail is only loaded when the cached copy says there is
+// less room than needed.
+static uint32_t shm_ringbuffer_space(shm_ringbuffer* rbuf, uint32_t head, uint32_t need)
+{
+	uint32_t space = rbuf->max - 1 - MOD2(head - rbuf->cached_tail, rbuf->max);
+	if (space < need) {
+		rbuf->cached_tail = atomic_load_explicit(&rbuf->header->tail, memory_order_acquire);
+		space = rbuf->max - 1 - MOD2(head - rbuf->cached_tail, rbuf->max);
+	}
+	return space;
+}
+
+// Returns the number of stored values as seen by the consumer. The
+// shared head is only loaded when the cached copy does not show
+// enough values.
+static uint32_t shm_ringbuffer_avail(shm_ringbuffer* rbuf, uint32_t tail, uint32_t need)
+{
+	uint32_t avail = MOD2(rbuf->cached_head - tail, rbuf->max);
+	if (avail < need) {
+		rbuf->cached_head = atomic_load_explicit(&rbuf->header->head, memory_order_acquire);
+		avail = MOD2(rbuf->cached_head - tail, rbuf->max);
+	}
+	return avail;
+}
+
+// Inserts the value at the head of the ringbuffer. Only one
+// process may insert. If the buffer is full, insertion will
+// fail, and the function returns false.
+// 
+// Returns true if insertion was successful.
+bool shm_ringbuffer_insert(shm_ringbuffer* rbuf, char value)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->header->head, memory_order_relaxed);
+	if (shm_ringbuffer_space(rbuf, head, 1) == 0)
+		return false;
+
+	rbuf->buffer[head] = value;
+	atomic_store_explicit(&rbuf->header->head, MOD2(head+1, rbuf->max), memory_order_release);
+	return true;
+}
+
+// Removes the value at the tail of the ringbuffer and stores
+// it in value. Only one process may remove.
+// 
+// Returns true if a value was removed, or false if the buffer is empty.
+bool shm_ringbuffer_remove(shm_ringbuffer* rbuf, char* value)
+{
+	uint32_t tail = atomic_load_explicit(&rbuf->header->tail, memory_order_relaxed);
+	if (shm_ringbuffer_avail(rbuf, tail, 1) == 0)
+		return false;
+
+	*value = rbuf->buffer[tail];
+	atomic_store_explicit(&rbuf->header->tail, MOD2(tail+1, rbuf->max), memory_order_release);
+	return true;
+}
+
+// Copies up to len values from src into the ringbuffer. Only one
+// process may insert. Values are only written while the buffer
+// is not full.
+// 
+// Returns the number of values written, which may be less than len.
+size_t shm_ringbuffer_write(shm_ringbuffer* rbuf, const char* src, size_t len)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->header->head, memory_order_relaxed);
+	uint32_t space = shm_ringbuffer_space(rbuf, head, len > rbuf->max ? rbuf->max : (uint32_t)len);
+	if (len > space)
+		len = space;
+
+	uint32_t first = rbuf->max - head;
+	if (first > len)
+		first = (uint32_t)len;
+	memcpy(rbuf->buffer + head, src, first);
+	memcpy(rbuf->buffer, src + first, len - first);
+
+	atomic_store_explicit(&rbuf->header->head, MOD2(head + (uint32_t)len, rbuf->max), memory_order_release);
+	return len;
+}
+
+// Removes up to len values from the tail of the ringbuffer and
+// copies them into dst. Only one process may remove.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t shm_ringbuffer_read(shm_ringbuffer* rbuf, char* dst, size_t len)
+{
+	uint32_t tail = atomic_load_explicit(&rbuf->header->tail, memory_order_relaxed);
+	uint32_t avail = shm_ringbuffer_avail(rbuf, tail, len > rbuf->max ? rbuf->max : (uint32_t)len);
+	if (len > avail)
+		len = avail;
+
+	uint32_t first = rbuf->max - tail;
+	if (first > len)
+		first = (uint32_t)len;
+	memcpy(dst, rbuf->buffer + tail, first);
+	memcpy(dst + first, rbuf->buffer, len - first);
+
+	atomic_store_explicit(&rbuf->header->tail, MOD2(tail + (uint32_t)len, rbuf->max), memory_order_release);
+	return len;
+}
+
+// Checks if the ringbuffer instance is empty. The result is only
+// a snapshot when the other side is running concurrently.
+// 
+// Returns true if it is empty, else it returns false.
+bool shm_ringbuffer_isempty(shm_ringbuffer* rbuf)
+{
+	return atomic_load_explicit(&rbuf->header->head, memory_order_acquire)
+		== atomic_load_explicit(&rbuf->header->tail, memory_order_acquire);
+}
@@ -0,0 +1,117 @@
+// A single-producer/single-consumer ring buffer in POSIX shared memory.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _SHM_RINGBUFFER_H_
+#define _SHM_RINGBUFFER_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ringbuffer.h"
+
+// Identifies an initialized shm_ringbuffer segment. Since the creator
+// stores it last, a process attaching to a segment that is still
+// being set up sees a mismatch and fails instead of reading garbage.
+#define SHM_RINGBUFFER_MAGIC 0x52425546u
+
+// Layout of the start of the shared memory segment. It only holds
+// sizes and indices, never pointers, so it means the same thing in
+// every process no matter where the segment is mapped. The values
+// follow right after the header.
+typedef struct _shm_ringbuffer_header {
+	_Atomic uint32_t magic;         // SHM_RINGBUFFER_MAGIC once initialized
+	uint32_t max;                   // max number of elements in the buffer
+	char pad0[RINGBUFFER_CACHE_LINE - 2 * sizeof(uint32_t)];
+	_Atomic uint32_t head;          // input, written by the producer
+	char pad1[RINGBUFFER_CACHE_LINE - sizeof(uint32_t)];
+	_Atomic uint32_t tail;          // output, written by the consumer
+	char pad2[RINGBUFFER_CACHE_LINE - sizeof(uint32_t)];
+} shm_ringbuffer_header;
+
+// Process local handle to a shared ringbuffer. No ringbuffer_counters
+// are kept, since RINGBUFFER_STATS must not change the shared layout
+// that processes built with different flags agree on.
+typedef struct _shm_ringbuffer {
+	shm_ringbuffer_header* header;  // start of the mapped segment
+	char* buffer;                   // values, as mapped in this process
+	uint32_t max;                   // max number of elements in the buffer
+	uint32_t cached_head;           // consumer's last view of the head
+	uint32_t cached_tail;           // producer's last view of the tail
+	char* name;                     // name of the segment, set if we created it
+} shm_ringbuffer;
+
+// Creates a new shared memory segment called name, which must
+// start with a '/' and must not exist yet, holding a ringbuffer
+// with space for n-1 elements where n must be a power of 2.
+// The segment is removed again by delete_shm_ringbuffer.
+// 
+// Returns a handle to the ringbuffer, or NULL if it failed.
+shm_ringbuffer* new_shm_ringbuffer(const char* name, uint32_t n);
+
+// Attaches to the ringbuffer in the existing shared memory
+// segment called name, created by new_shm_ringbuffer in this
+// or another process.
+// 
+// Returns a handle to the ringbuffer, or NULL if it failed.
+shm_ringbuffer* open_shm_ringbuffer(const char* name);
+
+// Unmaps the ringbuffer and frees the handle. If the handle was
+// returned by new_shm_ringbuffer, the segment is removed as well,
+// though processes that are still attached can keep using it.
+void delete_shm_ringbuffer(shm_ringbuffer* rbuf);
+
+// Inserts the value at the head of the ringbuffer. Only one
+// process may insert. If the buffer is full, insertion will
+// fail, and the function returns false.
+// 
+// Returns true if insertion was successful.
+bool shm_ringbuffer_insert(shm_ringbuffer* rbuf, char value);
+
+// Removes the value at the tail of the ringbuffer and stores
+// it in value. Only one process may remove.
+// 
+// Returns true if a value was removed, or false if the buffer is empty.
+bool shm_ringbuffer_remove(shm_ringbuffer* rbuf, char* value);
+
+// Copies up to len values from src into the ringbuffer. Only one
+// process may insert. Values are only written while the buffer
+// is not full.
+// 
+// Returns the number of values written, which may be less than len.
+size_t shm_ringbuffer_write(shm_ringbuffer* rbuf, const char* src, size_t len);
+
+// Removes up to len values from the tail of the ringbuffer and
+// copies them into dst. Only one process may remove.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t shm_ringbuffer_read(shm_ringbuffer* rbuf, char* dst, size_t len);
+
+// Checks if the ringbuffer instance is empty. The result is only
+// a snapshot when the other side is running concurrently.
+// 
+// Returns true if it is empty, else it returns false.
+bool shm_ringbuffer_isempty(shm_ringbuffer* rbuf);
+
+#endif
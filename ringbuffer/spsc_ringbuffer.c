@@ -0,0 +1,411 @@
+// A lock-free, single-producer/single-consumer ring buffer.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// syscall is a GNU extension.
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "spsc_ringbuffer.h"
+#include "ringbuffer_private.h"
+
+#ifdef __linux__
+	#include <unistd.h>
+	#include <sys/syscall.h>
+	#include <linux/futex.h>
+#endif
+
+// Bounds for how often a blocking call polls the buffer before it
+// goes to sleep. Each side doubles its limit when polling paid off
+// and halves it when it had to sleep anyway.
+#define SPSC_MIN_SPINS 16
+#define SPSC_MAX_SPINS 4096
+
+// Allocates a new spsc_ringbuffer with space for n-1 elements
+// where n must be a power of 2. Exactly one thread may insert
+// into the buffer and exactly one thread may remove from it.
+// 
+// Returns a pointer to the newly allocated spsc_ringbuffer,
+// or NULL if n is not a power of 2.
+spsc_ringbuffer* new_spsc_ringbuffer(uint32_t n)
+{
+	if (n == 0 || !ISPOW2(n))
+		return NULL;
+
+	spsc_ringbuffer* rbuf = malloc(sizeof(spsc_ringbuffer));
+
+	if (rbuf != NULL) {
+		rbuf->max         = n;
+		rbuf->cached_tail = 0;
+		rbuf->cached_head = 0;
+		rbuf->producer_spins = SPSC_MAX_SPINS;
+		rbuf->consumer_spins = SPSC_MAX_SPINS;
+		rbuf->buffer      = malloc(sizeof(char) * n);
+		atomic_init(&rbuf->head, 0);
+		atomic_init(&rbuf->tail, 0);
+		atomic_init(&rbuf->producer_waiting, 0);
+		atomic_init(&rbuf->consumer_waiting, 0);
+		RINGBUFFER_STAT(
+		atomic_init(&rbuf->inserts, 0);
+		atomic_init(&rbuf->rejected, 0);
+		atomic_init(&rbuf->high_water, 0);
+		atomic_init(&rbuf->removes, 0);
+		atomic_init(&rbuf->empty_removes, 0);
+		)
+	}
+
+	return rbuf;
+}
+
+// Frees memory used by spsc_ringbuffer. Neither side
+// may be using the buffer anymore.
+void delete_spsc_ringbuffer(spsc_ringbuffer* rbuf)
+{
+	free(rbuf->buffer);
+	free(rbuf);
+}
+
+// Returns the number of free slots as seen by the producer. The
+// shared tail is only loaded when the cached copy says there is
+// less room than needed, so the consumer's cache line is not
+// touched on every insert.
+static uint32_t spsc_ringbuffer_space(spsc_ringbuffer* rbuf, uint32_t head, uint32_t need)
+{
+	uint32_t space = rbuf->max - 1 - MOD2(head - rbuf->cached_tail, rbuf->max);
+	if (space < need) {
+		rbuf->cached_tail = atomic_load_explicit(&rbuf->tail, memory_order_acquire);
+		space = rbuf->max - 1 - MOD2(head - rbuf->cached_tail, rbuf->max);
+	}
+	return space;
+}
+
+// Returns the number of stored values as seen by the consumer.
+// Like spsc_ringbuffer_space, the shared head is only loaded
+// when the cached copy does not show enough values.
+static uint32_t spsc_ringbuffer_avail(spsc_ringbuffer* rbuf, uint32_t tail, uint32_t need)
+{
+	uint32_t avail = MOD2(rbuf->cached_head - tail, rbuf->max);
+	if (avail < need) {
+		rbuf->cached_head = atomic_load_explicit(&rbuf->head, memory_order_acquire);
+		avail = MOD2(rbuf->cached_head - tail, rbuf->max);
+	}
+	return avail;
+}
+
+#ifdef RINGBUFFER_STATS
+// Counts len of want values inserted at head, on the producer side.
+static void spsc_ringbuffer_count_insert(spsc_ringbuffer* rbuf, uint32_t head, size_t want, size_t len)
+{
+	STAT_ADD(rbuf->inserts, len);
+	STAT_ADD(rbuf->rejected, want - len);
+	STAT_MAX(rbuf->high_water, MOD2(head + (uint32_t)len - rbuf->cached_tail, rbuf->max));
+}
+#endif
+
+// Inserts the value at the head of the ringbuffer.
+// Producer side only. If the buffer is full, insertion
+// will fail, and the function returns false.
+// 
+// Returns true if insertion was successful.
+bool spsc_ringbuffer_insert(spsc_ringbuffer* rbuf, char value)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->head, memory_order_relaxed);
+	if (spsc_ringbuffer_space(rbuf, head, 1) == 0) {
+		RINGBUFFER_STAT(STAT_ADD(rbuf->rejected, 1);)
+		return false;
+	}
+
+	rbuf->buffer[head] = value;
+	atomic_store_explicit(&rbuf->head, MOD2(head+1, rbuf->max), memory_order_release);
+	RINGBUFFER_STAT(spsc_ringbuffer_count_insert(rbuf, head, 1, 1);)
+	return true;
+}
+
+// Removes the value at the tail of the ringbuffer and
+// stores it in value. Consumer side only.
+// 
+// Returns true if a value was removed, or false if the buffer is empty.
+bool spsc_ringbuffer_remove(spsc_ringbuffer* rbuf, char* value)
+{
+	uint32_t tail = atomic_load_explicit(&rbuf->tail, memory_order_relaxed);
+	if (spsc_ringbuffer_avail(rbuf, tail, 1) == 0) {
+		RINGBUFFER_STAT(STAT_ADD(rbuf->empty_removes, 1);)
+		return false;
+	}
+
+	*value = rbuf->buffer[tail];
+	atomic_store_explicit(&rbuf->tail, MOD2(tail+1, rbuf->max), memory_order_release);
+	RINGBUFFER_STAT(STAT_ADD(rbuf->removes, 1);)
+	return true;
+}
+
+// Stores the value at the tail of the ringbuffer in value
+// without removing it. Consumer side only.
+// 
+// Returns true if there was a value, or false if the buffer is empty.
+bool spsc_ringbuffer_peek(spsc_ringbuffer* rbuf, char* value)
+{
+	uint32_t tail = atomic_load_explicit(&rbuf->tail, memory_order_relaxed);
+	if (spsc_ringbuffer_avail(rbuf, tail, 1) == 0)
+		return false;
+
+	*value = rbuf->buffer[tail];
+	return true;
+}
+
+// Tells the CPU we are in a spin loop.
+static inline void spsc_ringbuffer_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// Sleeps until word no longer holds expected, the timeout
+// expires, or we are woken. Without futexes this just yields.
+static void spsc_ringbuffer_sleep(_Atomic uint32_t* word, uint32_t expected, const struct timespec* timeout)
+{
+#ifdef __linux__
+	syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+#else
+	sched_yield();
+#endif
+}
+
+// Wakes the other side if it is asleep on word. The fence pairs with
+// the one in spsc_ringbuffer_wait: either the sleeper sees the index
+// we just published, or we see its waiting flag.
+static void spsc_ringbuffer_wake(_Atomic uint32_t* word, _Atomic uint32_t* waiting)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(waiting, memory_order_relaxed)) {
+#ifdef __linux__
+		syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+	}
+}
+
+// Returns the current time on the monotonic clock in nanoseconds.
+static int64_t spsc_ringbuffer_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Waits until ready returns true for the calling side. Polls for
+// up to *spins rounds first, then registers in waiting and sleeps
+// on word, which is the index the other side moves.
+// 
+// Returns true once ready, or false if timeout_ms expired first.
+static bool spsc_ringbuffer_wait(spsc_ringbuffer* rbuf, bool (*ready)(spsc_ringbuffer*),
+	_Atomic uint32_t* word, _Atomic uint32_t* waiting, uint32_t* spins, int timeout_ms)
+{
+	for (uint32_t i = 0; i < *spins; ++i) {
+		if (ready(rbuf)) {
+			if (*spins < SPSC_MAX_SPINS)
+				*spins *= 2;
+			return true;
+		}
+		spsc_ringbuffer_relax();
+	}
+
+	if (*spins > SPSC_MIN_SPINS)
+		*spins /= 2;
+
+	int64_t deadline = spsc_ringbuffer_now() + (int64_t)timeout_ms * 1000000;
+	for (;;) {
+		atomic_store_explicit(waiting, 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		uint32_t seen = atomic_load_explicit(word, memory_order_relaxed);
+
+		if (ready(rbuf)) {
+			atomic_store_explicit(waiting, 0, memory_order_relaxed);
+			return true;
+		}
+
+		struct timespec ts, *timeout = NULL;
+		if (timeout_ms >= 0) {
+			int64_t left = deadline - spsc_ringbuffer_now();
+			if (left <= 0) {
+				atomic_store_explicit(waiting, 0, memory_order_relaxed);
+				return false;
+			}
+			ts.tv_sec = left / 1000000000;
+			ts.tv_nsec = left % 1000000000;
+			timeout = &ts;
+		}
+
+		// Returns right away if word moved since we looked at it.
+		spsc_ringbuffer_sleep(word, seen, timeout);
+	}
+}
+
+// Checks if the producer can insert a value.
+static bool spsc_ringbuffer_canpush(spsc_ringbuffer* rbuf)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->head, memory_order_relaxed);
+	return spsc_ringbuffer_space(rbuf, head, 1) > 0;
+}
+
+// Checks if the consumer can remove a value.
+static bool spsc_ringbuffer_canpop(spsc_ringbuffer* rbuf)
+{
+	uint32_t tail = atomic_load_explicit(&rbuf->tail, memory_order_relaxed);
+	return spsc_ringbuffer_avail(rbuf, tail, 1) > 0;
+}
+
+// Inserts the value at the head of the ringbuffer like
+// spsc_ringbuffer_insert, but waits while the buffer is full.
+// It spins for a while first, then sleeps until the consumer
+// removes a value. A negative timeout_ms waits forever.
+// 
+// A consumer sleeping in spsc_ringbuffer_pop_wait is only woken
+// by this function, so a producer feeding a blocking consumer must
+// use it instead of spsc_ringbuffer_insert. The wakeup is only a
+// system call when the consumer is actually asleep.
+// 
+// Returns true if insertion was successful, or false on timeout.
+bool spsc_ringbuffer_push_wait(spsc_ringbuffer* rbuf, char value, int timeout_ms)
+{
+	if (!spsc_ringbuffer_insert(rbuf, value)) {
+		if (!spsc_ringbuffer_wait(rbuf, spsc_ringbuffer_canpush, &rbuf->tail,
+				&rbuf->producer_waiting, &rbuf->producer_spins, timeout_ms))
+			return false;
+		spsc_ringbuffer_insert(rbuf, value);
+	}
+
+	spsc_ringbuffer_wake(&rbuf->head, &rbuf->consumer_waiting);
+	return true;
+}
+
+// Removes the value at the tail of the ringbuffer like
+// spsc_ringbuffer_remove, but waits while the buffer is empty.
+// It spins for a while first, then sleeps until the producer
+// inserts a value. A negative timeout_ms waits forever.
+// 
+// Like spsc_ringbuffer_push_wait, a producer sleeping in
+// spsc_ringbuffer_push_wait is only woken by this function.
+// 
+// Returns true if a value was removed, or false on timeout.
+bool spsc_ringbuffer_pop_wait(spsc_ringbuffer* rbuf, char* value, int timeout_ms)
+{
+	if (!spsc_ringbuffer_remove(rbuf, value)) {
+		if (!spsc_ringbuffer_wait(rbuf, spsc_ringbuffer_canpop, &rbuf->head,
+				&rbuf->consumer_waiting, &rbuf->consumer_spins, timeout_ms))
+			return false;
+		spsc_ringbuffer_remove(rbuf, value);
+	}
+
+	spsc_ringbuffer_wake(&rbuf->tail, &rbuf->producer_waiting);
+	return true;
+}
+
+// Copies up to len values from src into the ringbuffer.
+// Producer side only. Values are only written while the
+// buffer is not full.
+// 
+// Returns the number of values written, which may be less than len.
+size_t spsc_ringbuffer_write(spsc_ringbuffer* rbuf, const char* src, size_t len)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->head, memory_order_relaxed);
+	uint32_t space = spsc_ringbuffer_space(rbuf, head, len > rbuf->max ? rbuf->max : (uint32_t)len);
+	RINGBUFFER_STAT(size_t want = len;)
+	if (len > space)
+		len = space;
+
+	uint32_t first = rbuf->max - head;
+	if (first > len)
+		first = (uint32_t)len;
+	memcpy(rbuf->buffer + head, src, first);
+	memcpy(rbuf->buffer, src + first, len - first);
+
+	atomic_store_explicit(&rbuf->head, MOD2(head + (uint32_t)len, rbuf->max), memory_order_release);
+	RINGBUFFER_STAT(spsc_ringbuffer_count_insert(rbuf, head, want, len);)
+	return len;
+}
+
+// Removes up to len values from the tail of the ringbuffer
+// and copies them into dst. Consumer side only.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t spsc_ringbuffer_read(spsc_ringbuffer* rbuf, char* dst, size_t len)
+{
+	uint32_t tail = atomic_load_explicit(&rbuf->tail, memory_order_relaxed);
+	uint32_t avail = spsc_ringbuffer_avail(rbuf, tail, len > rbuf->max ? rbuf->max : (uint32_t)len);
+	RINGBUFFER_STAT(STAT_ADD(rbuf->empty_removes, avail == 0 && len > 0);)
+	if (len > avail)
+		len = avail;
+
+	uint32_t first = rbuf->max - tail;
+	if (first > len)
+		first = (uint32_t)len;
+	memcpy(dst, rbuf->buffer + tail, first);
+	memcpy(dst + first, rbuf->buffer, len - first);
+
+	atomic_store_explicit(&rbuf->tail, MOD2(tail + (uint32_t)len, rbuf->max), memory_order_release);
+	RINGBUFFER_STAT(STAT_ADD(rbuf->removes, len);)
+	return len;
+}
+
+// Returns a snapshot of the counters of the ringbuffer, or all zeros
+// when built without RINGBUFFER_STATS. Each side only updates the
+// counters on its own cache line, so counting adds no sharing between
+// the threads. The high-water mark is measured against the producer's
+// cached view of the tail, so it may run slightly high. Nothing is ever
+// overwritten. Can be called from any thread.
+ringbuffer_counters spsc_ringbuffer_stats(spsc_ringbuffer* rbuf)
+{
+	ringbuffer_counters stats = {0};
+	(void)rbuf;
+	RINGBUFFER_STAT(
+	stats.inserts       = atomic_load_explicit(&rbuf->inserts, memory_order_relaxed);
+	stats.rejected      = atomic_load_explicit(&rbuf->rejected, memory_order_relaxed);
+	stats.high_water    = atomic_load_explicit(&rbuf->high_water, memory_order_relaxed);
+	stats.removes       = atomic_load_explicit(&rbuf->removes, memory_order_relaxed);
+	stats.empty_removes = atomic_load_explicit(&rbuf->empty_removes, memory_order_relaxed);
+	)
+	return stats;
+}
+
+// Checks if the ringbuffer instance is empty. The result is only
+// a snapshot when the other side is running concurrently.
+// 
+// Returns true if it is empty, else it returns false.
+bool spsc_ringbuffer_isempty(spsc_ringbuffer* rbuf)
+{
+	return atomic_load_explicit(&rbuf->head, memory_order_acquire)
+		== atomic_load_explicit(&rbuf->tail, memory_order_acquire);
+}
+
+// Checks if the ringbuffer instance is full. The result is only
+// a snapshot when the other side is running concurrently.
+// 
+// Returns true if it is full, else it returns false.
+bool spsc_ringbuffer_isfull(spsc_ringbuffer* rbuf)
+{
+	uint32_t head = atomic_load_explicit(&rbuf->head, memory_order_acquire);
+	return MOD2(head+1, rbuf->max) == atomic_load_explicit(&rbuf->tail, memory_order_acquire);
+}
@@ -0,0 +1,150 @@
+// A lock-free, single-producer/single-consumer ring buffer.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _SPSC_RINGBUFFER_H_
+#define _SPSC_RINGBUFFER_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ringbuffer.h"
+
+typedef struct _spsc_ringbuffer {
+	uint32_t max;                   // max number of elements in the buffer
+	char* buffer;                   // underlying buffer
+	char pad0[RINGBUFFER_CACHE_LINE];
+	_Atomic uint32_t head;          // input, written by the producer
+	uint32_t cached_tail;           // producer's last view of the tail
+	uint32_t producer_spins;        // producer's current spin limit
+	RINGBUFFER_STAT(
+	_Atomic uint64_t inserts;       // counters kept by the producer
+	_Atomic uint64_t rejected;
+	_Atomic uint32_t high_water;
+	)
+	char pad1[RINGBUFFER_CACHE_LINE];
+	_Atomic uint32_t tail;          // output, written by the consumer
+	uint32_t cached_head;           // consumer's last view of the head
+	uint32_t consumer_spins;        // consumer's current spin limit
+	RINGBUFFER_STAT(
+	_Atomic uint64_t removes;       // counters kept by the consumer
+	_Atomic uint64_t empty_removes;
+	)
+	char pad2[RINGBUFFER_CACHE_LINE];
+	// Written only when a side parks, but read on every blocking
+	// push and pop, so the flags stay off the hot index lines.
+	_Atomic uint32_t producer_waiting; // producer is parked on tail
+	_Atomic uint32_t consumer_waiting; // consumer is parked on head
+	char pad3[RINGBUFFER_CACHE_LINE];
+} spsc_ringbuffer;
+
+// Allocates a new spsc_ringbuffer with space for n-1 elements
+// where n must be a power of 2. Exactly one thread may insert
+// into the buffer and exactly one thread may remove from it.
+// 
+// Returns a pointer to the newly allocated spsc_ringbuffer,
+// or NULL if n is not a power of 2.
+spsc_ringbuffer* new_spsc_ringbuffer(uint32_t n);
+
+// Frees memory used by spsc_ringbuffer. Neither side
+// may be using the buffer anymore.
+void delete_spsc_ringbuffer(spsc_ringbuffer* rbuf);
+
+// Inserts the value at the head of the ringbuffer.
+// Producer side only. If the buffer is full, insertion
+// will fail, and the function returns false.
+// 
+// Returns true if insertion was successful.
+bool spsc_ringbuffer_insert(spsc_ringbuffer* rbuf, char value);
+
+// Removes the value at the tail of the ringbuffer and
+// stores it in value. Consumer side only.
+// 
+// Returns true if a value was removed, or false if the buffer is empty.
+bool spsc_ringbuffer_remove(spsc_ringbuffer* rbuf, char* value);
+
+// Stores the value at the tail of the ringbuffer in value
+// without removing it. Consumer side only.
+// 
+// Returns true if there was a value, or false if the buffer is empty.
+bool spsc_ringbuffer_peek(spsc_ringbuffer* rbuf, char* value);
+
+// Inserts the value at the head of the ringbuffer like
+// spsc_ringbuffer_insert, but waits while the buffer is full.
+// It spins for a while first, then sleeps until the consumer
+// removes a value. A negative timeout_ms waits forever.
+// 
+// A consumer sleeping in spsc_ringbuffer_pop_wait is only woken
+// by this function, so a producer feeding a blocking consumer must
+// use it instead of spsc_ringbuffer_insert. The wakeup is only a
+// system call when the consumer is actually asleep.
+// 
+// Returns true if insertion was successful, or false on timeout.
+bool spsc_ringbuffer_push_wait(spsc_ringbuffer* rbuf, char value, int timeout_ms);
+
+// Removes the value at the tail of the ringbuffer like
+// spsc_ringbuffer_remove, but waits while the buffer is empty.
+// It spins for a while first, then sleeps until the producer
+// inserts a value. A negative timeout_ms waits forever.
+// 
+// Like spsc_ringbuffer_push_wait, a producer sleeping in
+// spsc_ringbuffer_push_wait is only woken by this function.
+// 
+// Returns true if a value was removed, or false on timeout.
+bool spsc_ringbuffer_pop_wait(spsc_ringbuffer* rbuf, char* value, int timeout_ms);
+
+// Copies up to len values from src into the ringbuffer.
+// Producer side only. Values are only written while the
+// buffer is not full.
+// 
+// Returns the number of values written, which may be less than len.
+size_t spsc_ringbuffer_write(spsc_ringbuffer* rbuf, const char* src, size_t len);
+
+// Removes up to len values from the tail of the ringbuffer
+// and copies them into dst. Consumer side only.
+// 
+// Returns the number of values read, or 0 if the buffer is empty.
+size_t spsc_ringbuffer_read(spsc_ringbuffer* rbuf, char* dst, size_t len);
+
+// Returns a snapshot of the counters of the ringbuffer, or all zeros
+// when built without RINGBUFFER_STATS. Each side only updates the
+// counters on its own cache line, so counting adds no sharing between
+// the threads. The high-water mark is measured against the producer's
+// cached view of the tail, so it may run slightly high. Nothing is ever
+// overwritten. Can be called from any thread.
+ringbuffer_counters spsc_ringbuffer_stats(spsc_ringbuffer* rbuf);
+
+// Checks if the ringbuffer instance is empty. The result is only
+// a snapshot when the other side is running concurrently.
+// 
+// Returns true if it is empty, else it returns false.
+bool spsc_ringbuffer_isempty(spsc_ringbuffer* rbuf);
+
+// Checks if the ringbuffer instance is full. The result is only
+// a snapshot when the other side is running concurrently.
+// 
+// Returns true if it is full, else it returns false.
+bool spsc_ringbuffer_isfull(spsc_ringbuffer* rbuf);
+
+#endif
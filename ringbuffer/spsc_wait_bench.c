@@ -0,0 +1,164 @@
+// Handoff latency benchmark for the blocking spsc_ringbuffer calls.
+// 
+// The MIT License
+//
+// Copyright (c) 2016-2017 Cody Balos. http://github.com/cojomojo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Passes values between two threads over a pair of spsc_ringbuffers,
+// one at a time, and reports the p50/p99 latency from the insert on
+// one thread to the remove on the other. Each mode runs with no gap
+// between values and with a gap, during which the receiving side has
+// nothing to do. The "spin" baseline polls spsc_ringbuffer_insert and
+// spsc_ringbuffer_remove, the "wait" mode uses spsc_ringbuffer_push_wait
+// and spsc_ringbuffer_pop_wait. The CPU time burned by the receiving
+// thread is reported as well. One CSV row is printed per run.
+// 
+// Usage: spsc_wait_bench [values per run] [gap in microseconds]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "spsc_ringbuffer.h"
+
+typedef struct _bench_run {
+	bool wait;
+	size_t values;
+	spsc_ringbuffer* ping;      // sender to receiver
+	spsc_ringbuffer* pong;      // receiver back to sender
+	int64_t* sent;              // when each value was inserted
+	int64_t* received;          // when each value was removed
+	double receiver_cpu;        // CPU seconds used by the receiver
+} bench_run;
+
+static int64_t now_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static void bench_send(bench_run* run, spsc_ringbuffer* rbuf, char value)
+{
+	if (run->wait)
+		spsc_ringbuffer_push_wait(rbuf, value, -1);
+	else
+		while (!spsc_ringbuffer_insert(rbuf, value))
+			relax();
+}
+
+static char bench_recv(bench_run* run, spsc_ringbuffer* rbuf)
+{
+	char value;
+	if (run->wait)
+		spsc_ringbuffer_pop_wait(rbuf, &value, -1);
+	else
+		while (!spsc_ringbuffer_remove(rbuf, &value))
+			relax();
+	return value;
+}
+
+// Receives each value, stamps it and sends it back.
+static void* receiver(void* arg)
+{
+	bench_run* run = arg;
+	int64_t start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+
+	for (size_t i = 0; i < run->values; ++i) {
+		char value = bench_recv(run, run->ping);
+		run->received[i] = now_ns(CLOCK_MONOTONIC);
+		bench_send(run, run->pong, value);
+	}
+
+	run->receiver_cpu = (now_ns(CLOCK_THREAD_CPUTIME_ID) - start) * 1e-9;
+	return NULL;
+}
+
+static int compare_int64(const void* a, const void* b)
+{
+	int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+	return (x > y) - (x < y);
+}
+
+static void bench(bool wait, size_t values, long gap_us)
+{
+	bench_run run = { wait, values };
+	struct timespec gap = { gap_us / 1000000, (gap_us % 1000000) * 1000 };
+	pthread_t thread;
+
+	run.ping = new_spsc_ringbuffer(64);
+	run.pong = new_spsc_ringbuffer(64);
+	run.sent = malloc(sizeof(int64_t) * values);
+	run.received = malloc(sizeof(int64_t) * values);
+
+	int64_t start = now_ns(CLOCK_MONOTONIC);
+	pthread_create(&thread, NULL, receiver, &run);
+	for (size_t i = 0; i < values; ++i) {
+		if (gap_us > 0)
+			nanosleep(&gap, NULL);
+		run.sent[i] = now_ns(CLOCK_MONOTONIC);
+		bench_send(&run, run.ping, (char)i);
+		bench_recv(&run, run.pong);
+	}
+	pthread_join(thread, NULL);
+	double elapsed = (now_ns(CLOCK_MONOTONIC) - start) * 1e-9;
+
+	for (size_t i = 0; i < values; ++i)
+		run.received[i] -= run.sent[i];
+	qsort(run.received, values, sizeof(int64_t), compare_int64);
+
+	printf("%s,%ld,%zu,%lld,%lld,%lld,%.1f\n", wait ? "wait" : "spin", gap_us, values,
+		(long long)run.received[values / 2], (long long)run.received[values * 99 / 100],
+		(long long)run.received[values - 1], 100.0 * run.receiver_cpu / elapsed);
+	fflush(stdout);
+
+	free(run.sent);
+	free(run.received);
+	delete_spsc_ringbuffer(run.ping);
+	delete_spsc_ringbuffer(run.pong);
+}
+
+int main(int argc, char** argv)
+{
+	size_t values = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+	long gap_us = argc > 2 ? atol(argv[2]) : 50;
+
+	if (values == 0)
+		return 1;
+
+	printf("mode,gap_us,values,p50_ns,p99_ns,max_ns,receiver_cpu_pct\n");
+	bench(false, values, 0);
+	bench(true, values, 0);
+	if (gap_us > 0) {
+		bench(false, values, gap_us);
+		bench(true, values, gap_us);
+	}
+	return 0;
+}
@@ -1,12 +1,37 @@
+// fork and waitpid are POSIX, not C11.
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdarg.h>
 #include <stddef.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <google/cmockery.h>
 #include "ringbuffer.h"
+#include "spsc_ringbuffer.h"
+#include "mpmc_queue.h"
+#include "shm_ringbuffer.h"
+#include "bcast_ringbuffer.h"
+#include "grow_ringbuffer.h"
+
+// Typed instances of the ringbuffer templates.
+typedef struct _record {
+	uint64_t id;
+	char payload[56];
+} record;
+
+RINGBUFFER_DEFINE(u64_ringbuffer, uint64_t)
+RINGBUFFER_DEFINE(record_ringbuffer, record)
 
 static ringbuffer *rbuffer;
+static spsc_ringbuffer *spsc;
+static mpmc_queue *mpmc;
 
 // Creates a new ringbuffer and sets the state 
 // properly before running a unit test on 
@@ -123,8 +148,1020 @@ void test_rbuffer_isempty(void **state)
 	assert_false(ringbuffer_isempty(rbuffer));
 }
 
-int main(void)
+void test_rbuffer_write(void **state)
+{
+	assert_int_equal(ringbuffer_write(rbuffer, "Co", 2), 2);
+	assert_true(rbuffer->buffer[0] == 'C');
+	assert_true(rbuffer->buffer[1] == 'o');
+
+	// wraps around the end, overwriting the front
+	assert_int_equal(ringbuffer_write(rbuffer, "dyB", 3), 3);
+	assert_true(rbuffer->buffer[2] == 'd');
+	assert_true(rbuffer->buffer[3] == 'y');
+	assert_true(rbuffer->buffer[0] == 'B');
+	assert_int_equal(rbuffer->head, 1);
+	assert_int_equal(rbuffer->tail, 0);
+
+	// longer than the buffer, only the last n values remain
+	assert_int_equal(ringbuffer_write(rbuffer, "abcdefg", 7), 7);
+	assert_memory_equal(rbuffer->buffer, "defg", 4);
+	assert_int_equal(rbuffer->head, 0);
+}
+
+void test_rbuffer_sfwrite(void **state)
+{
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, "Co", 2), 2);
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, "dy", 2), 1);
+	assert_true(ringbuffer_isfull(rbuffer));
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, "y", 1), 0);
+	assert_memory_equal(rbuffer->buffer, "Cod", 3);
+
+	// the partial write wraps around the end
+	ringbuffer_remove(rbuffer);
+	ringbuffer_remove(rbuffer);
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, "yBa", 3), 2);
+	assert_true(rbuffer->buffer[3] == 'y');
+	assert_true(rbuffer->buffer[0] == 'B');
+	assert_int_equal(rbuffer->head, 1);
+}
+
+void test_rbuffer_read(void **state)
+{
+	char out[4] = {0};
+
+	assert_int_equal(ringbuffer_read(rbuffer, out, sizeof(out)), 0);
+
+	ringbuffer_sfwrite(rbuffer, "Cod", 3);
+	assert_int_equal(ringbuffer_read(rbuffer, out, 2), 2);
+	assert_memory_equal(out, "Co", 2);
+	assert_int_equal(rbuffer->tail, 2);
+
+	// the remaining value plus two wrapped ones
+	ringbuffer_sfwrite(rbuffer, "yB", 2);
+	assert_int_equal(ringbuffer_read(rbuffer, out, sizeof(out)), 3);
+	assert_memory_equal(out, "dyB", 3);
+	assert_int_equal(rbuffer->tail, 1);
+	assert_true(ringbuffer_isempty(rbuffer));
+}
+
+void test_rbuffer_peekn(void **state)
 {
+	char out[4] = {0};
+
+	assert_int_equal(ringbuffer_peekn(rbuffer, out, sizeof(out)), 0);
+
+	ringbuffer_sfwrite(rbuffer, "Cod", 3);
+	ringbuffer_remove(rbuffer);
+	ringbuffer_remove(rbuffer);
+	ringbuffer_sfwrite(rbuffer, "yB", 2);
+	assert_int_equal(ringbuffer_peekn(rbuffer, out, sizeof(out)), 3);
+	assert_memory_equal(out, "dyB", 3);
+	assert_int_equal(rbuffer->tail, 2);
+	assert_int_equal(ringbuffer_count(rbuffer), 3);
+}
+
+void test_rbuffer_stats(void **state)
+{
+	char out[4];
+	ringbuffer_counters stats = ringbuffer_stats(rbuffer);
+	assert_int_equal(stats.inserts, 0);
+	assert_int_equal(stats.high_water, 0);
+
+	ringbuffer_sfinsert(rbuffer, 'C');
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, "ody", 3), 2);
+	assert_false(ringbuffer_sfinsert(rbuffer, 'y'));
+	ringbuffer_remove(rbuffer);
+	ringbuffer_read(rbuffer, out, sizeof(out));
+	ringbuffer_remove(rbuffer);
+	ringbuffer_read(rbuffer, out, sizeof(out));
+
+	stats = ringbuffer_stats(rbuffer);
+	assert_int_equal(stats.inserts, 3);
+	assert_int_equal(stats.rejected, 2);
+	assert_int_equal(stats.removes, 3);
+	assert_int_equal(stats.empty_removes, 2);
+	assert_int_equal(stats.high_water, 3);
+	assert_int_equal(stats.overwritten, 0);
+
+	// inserting into a full buffer wraps it around to empty,
+	// losing the three stored values and the new one
+	ringbuffer_write(rbuffer, "Cod", 3);
+	ringbuffer_insert(rbuffer, 'y');
+	assert_true(ringbuffer_isempty(rbuffer));
+	stats = ringbuffer_stats(rbuffer);
+	assert_int_equal(stats.inserts, 7);
+	assert_int_equal(stats.overwritten, 4);
+
+	// a write longer than the buffer keeps its last value
+	ringbuffer_write(rbuffer, "abcdefghi", 9);
+	stats = ringbuffer_stats(rbuffer);
+	assert_int_equal(ringbuffer_count(rbuffer), 1);
+	assert_int_equal(stats.overwritten, 12);
+}
+
+void test_rbuffer_spans(void **state)
+{
+	size_t len;
+
+	char* span = ringbuffer_write_span(rbuffer, &len);
+	assert_true(span == rbuffer->buffer);
+	assert_int_equal(len, 3);
+	memcpy(span, "Co", 2);
+	ringbuffer_commit(rbuffer, 2);
+
+	span = ringbuffer_read_span(rbuffer, &len);
+	assert_int_equal(len, 2);
+	assert_memory_equal(span, "Co", 2);
+	ringbuffer_consume(rbuffer, 2);
+	assert_true(ringbuffer_isempty(rbuffer));
+
+	// without a mirror the spans stop at the end of the buffer
+	span = ringbuffer_write_span(rbuffer, &len);
+	assert_true(span == rbuffer->buffer + 2);
+	assert_int_equal(len, 2);
+	ringbuffer_commit(rbuffer, 2);
+	ringbuffer_sfinsert(rbuffer, 'y');
+	span = ringbuffer_read_span(rbuffer, &len);
+	assert_int_equal(len, 2);
+}
+
+void test_rbuffer_find(void **state)
+{
+	ringbuffer* rbuf = new_ringbuffer(128);
+	char text[100];
+
+	// Place the contents across the end of the buffer, with
+	// delimiters in both parts and past the vector widths.
+	memset(text, 'x', sizeof(text));
+	ringbuffer_write(rbuf, text, 90);
+	ringbuffer_read(rbuf, text, 90);
+	text[20] = ';';
+	text[70] = '\n';
+	text[99] = '\n';
+	assert_int_equal(ringbuffer_sfwrite(rbuf, text, 100), 100);
+
+	assert_int_equal(ringbuffer_find(rbuf, ';'), 20);
+	assert_int_equal(ringbuffer_find(rbuf, '\n'), 70);
+	assert_int_equal(ringbuffer_find(rbuf, '?'), RINGBUFFER_NOT_FOUND);
+
+	char line[100];
+	assert_int_equal(ringbuffer_read_until(rbuf, ';', line, sizeof(line)), 21);
+	assert_int_equal(line[20], ';');
+	assert_int_equal(ringbuffer_read_until(rbuf, '\n', line, 16), 16);
+	assert_int_equal(line[15], 'x');
+	assert_int_equal(ringbuffer_read_until(rbuf, '\n', line, sizeof(line)), 34);
+	assert_int_equal(line[33], '\n');
+	assert_int_equal(ringbuffer_find(rbuf, ';'), RINGBUFFER_NOT_FOUND);
+	assert_int_equal(ringbuffer_find(rbuf, '\n'), 28);
+
+	// An incomplete record stays stored until it is complete
+	// or fills the capacity of the caller.
+	ringbuffer_read(rbuf, line, 29);
+	ringbuffer_sfwrite(rbuf, "abc", 3);
+	assert_int_equal(ringbuffer_read_until(rbuf, '\n', line, sizeof(line)), 0);
+	assert_int_equal(ringbuffer_count(rbuf), 3);
+	assert_int_equal(ringbuffer_read_until(rbuf, '\n', line, 3), 3);
+	assert_memory_equal(line, "abc", 3);
+	assert_int_equal(ringbuffer_find(rbuf, 'a'), RINGBUFFER_NOT_FOUND);
+	delete_ringbuffer(rbuf);
+}
+
+void test_rbuffer_read_frame(void **state)
+{
+	ringbuffer* rbuf = new_ringbuffer(16);
+	char frame[16];
+	size_t len;
+
+	ringbuffer_sfwrite(rbuf, "0123456789", 10);
+	ringbuffer_read(rbuf, frame, 10);
+
+	// The prefix and the record arrive in pieces, across the wrap.
+	ringbuffer_sfwrite(rbuf, "\0\0", 2);
+	assert_false(ringbuffer_read_frame(rbuf, frame, sizeof(frame), &len));
+	assert_int_equal(len, 0);
+	ringbuffer_sfwrite(rbuf, "\0\5hel", 5);
+	assert_false(ringbuffer_read_frame(rbuf, frame, sizeof(frame), &len));
+	assert_int_equal(len, 5);
+	assert_int_equal(ringbuffer_count(rbuf), 7);
+	ringbuffer_sfwrite(rbuf, "lo\0\0\0\0", 6);
+	assert_false(ringbuffer_read_frame(rbuf, frame, 4, &len));
+	assert_int_equal(len, 5);
+	assert_true(ringbuffer_read_frame(rbuf, frame, sizeof(frame), &len));
+	assert_int_equal(len, 5);
+	assert_memory_equal(frame, "hello", 5);
+
+	// Empty records are complete once their prefix is.
+	assert_true(ringbuffer_read_frame(rbuf, frame, sizeof(frame), &len));
+	assert_int_equal(len, 0);
+	assert_true(ringbuffer_isempty(rbuf));
+	assert_false(ringbuffer_read_frame(rbuf, frame, sizeof(frame), &len));
+
+	// A record the ringbuffer can never hold whole is reported by its length.
+	assert_int_equal(ringbuffer_frame_limit(rbuf), 11);
+	ringbuffer_sfwrite(rbuf, "\0\0\0\14abcdefghijk", 15);
+	assert_true(ringbuffer_isfull(rbuf));
+	assert_false(ringbuffer_read_frame(rbuf, frame, sizeof(frame), &len));
+	assert_int_equal(len, 12);
+	assert_true(len > ringbuffer_frame_limit(rbuf));
+	delete_ringbuffer(rbuf);
+}
+
+void test_mirrored_ringbuffer(void **state)
+{
+	// the size must be a multiple of the page size, which is not 4K everywhere
+	uint32_t page = (uint32_t)sysconf(_SC_PAGESIZE);
+	uint32_t n = 2 * page;
+	size_t size = n / 4 * 3;
+	size_t len;
+	char* data = test_malloc(size);
+
+	assert_true(new_mirrored_ringbuffer(16) == NULL);
+	assert_true(new_mirrored_ringbuffer(3 * page) == NULL);
+
+	rbuffer = new_mirrored_ringbuffer(n);
+	assert_true(rbuffer != NULL);
+	assert_true(rbuffer->mirrored);
+
+	// move the indices close to the end so the data wraps
+	for (size_t i = 0; i < size; ++i)
+		data[i] = (char)(i * 7);
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, data, size), size);
+	assert_int_equal(ringbuffer_read(rbuffer, data, size), size);
+
+	char* span = ringbuffer_write_span(rbuffer, &len);
+	assert_int_equal(len, n - 1);
+	memcpy(span, data, size);
+	ringbuffer_commit(rbuffer, size);
+	assert_int_equal(rbuffer->head, 2 * size - n);
+
+	// the whole wrapped region is readable in one piece
+	span = ringbuffer_read_span(rbuffer, &len);
+	assert_int_equal(len, size);
+	assert_memory_equal(span, data, size);
+	ringbuffer_consume(rbuffer, len);
+	assert_true(ringbuffer_isempty(rbuffer));
+
+	// the copying calls still work on a mirrored buffer
+	assert_int_equal(ringbuffer_sfwrite(rbuffer, data, size), size);
+	assert_int_equal(ringbuffer_peekn(rbuffer, data, size), size);
+	span = ringbuffer_read_span(rbuffer, &len);
+	assert_memory_equal(span, data, size);
+
+	delete_ringbuffer(rbuffer);
+	test_free(data);
+}
+
+void test_template_u64(void **state)
+{
+	uint64_t out[4];
+	uint64_t values[] = { 1ULL << 40, 2, 3, 4 };
+	u64_ringbuffer* rbuf = new_u64_ringbuffer(4);
+
+	assert_true(rbuf != NULL);
+	assert_true(new_u64_ringbuffer(11) == NULL);
+	assert_int_equal(u64_ringbuffer_remove(rbuf), 0);
+
+	assert_true(u64_ringbuffer_sfinsert(rbuf, values[0]));
+	assert_int_equal(u64_ringbuffer_sfwrite(rbuf, values + 1, 3), 2);
+	assert_true(u64_ringbuffer_isfull(rbuf));
+	assert_false(u64_ringbuffer_sfinsert(rbuf, 5));
+	assert_true(u64_ringbuffer_peek(rbuf) == 1ULL << 40);
+	assert_true(u64_ringbuffer_remove(rbuf) == 1ULL << 40);
+
+	// wraps around the end
+	u64_ringbuffer_insert(rbuf, 5);
+	assert_int_equal(u64_ringbuffer_count(rbuf), 3);
+	assert_int_equal(u64_ringbuffer_read(rbuf, out, 4), 3);
+	assert_int_equal(out[0], 2);
+	assert_int_equal(out[1], 3);
+	assert_int_equal(out[2], 5);
+	assert_true(u64_ringbuffer_isempty(rbuf));
+
+	delete_u64_ringbuffer(rbuf);
+}
+
+void test_template_record(void **state)
+{
+	record in[3], out[3];
+	record_ringbuffer* rbuf = new_record_ringbuffer(2);
+
+	for (int i = 0; i < 3; ++i) {
+		in[i].id = i;
+		memset(in[i].payload, 'a' + i, sizeof(in[i].payload));
+	}
+
+	assert_int_equal(record_ringbuffer_sfwrite(rbuf, in, 3), 1);
+	assert_int_equal(record_ringbuffer_peekn(rbuf, out, 3), 1);
+	assert_memory_equal(&out[0], &in[0], sizeof(record));
+
+	// wraps around the end
+	assert_true(record_ringbuffer_remove(rbuf).id == 0);
+	assert_true(record_ringbuffer_sfinsert(rbuf, in[1]));
+	assert_true(record_ringbuffer_peek(rbuf).id == 1);
+	assert_int_equal(record_ringbuffer_read(rbuf, out, 3), 1);
+	assert_memory_equal(&out[0], &in[1], sizeof(record));
+
+	// a failed remove returns a zeroed record
+	out[0] = record_ringbuffer_remove(rbuf);
+	assert_true(out[0].id == 0 && out[0].payload[0] == 0);
+
+	delete_record_ringbuffer(rbuf);
+}
+
+// Creates a new spsc_ringbuffer before running
+// a unit test on the spsc_ringbuffer instance.
+void setup_spsc(void **state)
+{
+	spsc = new_spsc_ringbuffer(4);
+	*state = (void*)spsc;
+}
+
+// Deletes a spsc_ringbuffer after running
+// unit tests on the spsc_ringbuffer instance.
+void teardown_spsc(void **state)
+{
+	delete_spsc_ringbuffer((spsc_ringbuffer*)*state);
+}
+
+void test_new_spsc_ringbuffer(void **state)
+{
+	for (int i = 0; i < 16; ++i) {
+		spsc = new_spsc_ringbuffer(1 << i);
+		assert_true(spsc != NULL);
+		assert_true(spsc->max == (1 << i));
+		assert_true(spsc->buffer != NULL);
+		assert_true(spsc_ringbuffer_isempty(spsc));
+		delete_spsc_ringbuffer(spsc);
+	}
+
+	assert_true(new_spsc_ringbuffer(0) == NULL);
+	for (int i = 0; i < 8; ++i) {
+		spsc = new_spsc_ringbuffer(11 << i);
+		assert_true(spsc == NULL);
+	}
+
+	// head and tail must not share a cache line
+	assert_true(offsetof(spsc_ringbuffer, tail) - offsetof(spsc_ringbuffer, head)
+		>= RINGBUFFER_CACHE_LINE);
+
+	// nor may the waiting flags share one with the tail
+	assert_true(offsetof(spsc_ringbuffer, producer_waiting) - offsetof(spsc_ringbuffer, tail)
+		>= RINGBUFFER_CACHE_LINE);
+}
+
+void test_spsc_insert_remove(void **state)
+{
+	char value = 0;
+
+	assert_false(spsc_ringbuffer_remove(spsc, &value));
+	assert_false(spsc_ringbuffer_peek(spsc, &value));
+
+	assert_true(spsc_ringbuffer_insert(spsc, 'C'));
+	assert_true(spsc_ringbuffer_insert(spsc, 'o'));
+	assert_true(spsc_ringbuffer_insert(spsc, 'd'));
+	assert_true(spsc_ringbuffer_isfull(spsc));
+	assert_false(spsc_ringbuffer_insert(spsc, 'y'));
+
+	assert_true(spsc_ringbuffer_peek(spsc, &value));
+	assert_true(value == 'C');
+	assert_true(spsc_ringbuffer_remove(spsc, &value));
+	assert_true(value == 'C');
+
+	// wraps around the end
+	assert_true(spsc_ringbuffer_insert(spsc, 'y'));
+	assert_true(spsc_ringbuffer_remove(spsc, &value));
+	assert_true(value == 'o');
+	assert_true(spsc_ringbuffer_remove(spsc, &value));
+	assert_true(value == 'd');
+	assert_true(spsc_ringbuffer_remove(spsc, &value));
+	assert_true(value == 'y');
+	assert_true(spsc_ringbuffer_isempty(spsc));
+}
+
+void test_spsc_write_read(void **state)
+{
+	char out[4] = {0};
+
+	assert_int_equal(spsc_ringbuffer_write(spsc, "Cody", 4), 3);
+	assert_int_equal(spsc_ringbuffer_read(spsc, out, 2), 2);
+	assert_memory_equal(out, "Co", 2);
+	assert_int_equal(spsc_ringbuffer_write(spsc, "yB", 2), 2);
+	assert_int_equal(spsc_ringbuffer_read(spsc, out, sizeof(out)), 3);
+	assert_memory_equal(out, "dyB", 3);
+	assert_int_equal(spsc_ringbuffer_read(spsc, out, sizeof(out)), 0);
+}
+
+#define SPSC_STRESS_COUNT (1 << 22)
+
+// Producer for the spsc stress test. Inserts a running
+// sequence, one value at a time or in chunks. Both sides
+// yield when they cannot make progress so the test also
+// finishes quickly on a single core.
+static void* spsc_stress_producer(void* arg)
+{
+	bool bulk = *(bool*)arg;
+	char chunk[61];
+	uint32_t i = 0;
+
+	while (i < SPSC_STRESS_COUNT) {
+		if (bulk) {
+			size_t len = sizeof(chunk);
+			if (len > SPSC_STRESS_COUNT - i)
+				len = SPSC_STRESS_COUNT - i;
+			for (size_t j = 0; j < len; ++j)
+				chunk[j] = (char)(i + j);
+			size_t written = spsc_ringbuffer_write(spsc, chunk, len);
+			if (written == 0)
+				sched_yield();
+			i += written;
+		} else if (spsc_ringbuffer_insert(spsc, (char)i)) {
+			++i;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+// Runs a producer thread against a consumer on the calling
+// thread, and checks the values come out complete and in order.
+// Assertions stay on the calling thread since cmockery reports
+// failures with longjmp.
+static void spsc_stress(bool bulk)
+{
+	pthread_t producer;
+	char chunk[37];
+	uint32_t i = 0, errors = 0;
+
+	spsc = new_spsc_ringbuffer(1024);
+	assert_int_equal(pthread_create(&producer, NULL, spsc_stress_producer, &bulk), 0);
+
+	while (i < SPSC_STRESS_COUNT) {
+		if (bulk) {
+			size_t len = spsc_ringbuffer_read(spsc, chunk, sizeof(chunk));
+			if (len == 0)
+				sched_yield();
+			for (size_t j = 0; j < len; ++j, ++i)
+				errors += chunk[j] != (char)i;
+		} else if (spsc_ringbuffer_remove(spsc, chunk)) {
+			errors += chunk[0] != (char)i;
+			++i;
+		} else {
+			sched_yield();
+		}
+	}
+
+	pthread_join(producer, NULL);
+	assert_int_equal(errors, 0);
+	assert_true(spsc_ringbuffer_isempty(spsc));
+	delete_spsc_ringbuffer(spsc);
+}
+
+void test_spsc_stress(void **state)
+{
+	spsc_stress(false);
+}
+
+void test_spsc_stress_bulk(void **state)
+{
+	spsc_stress(true);
+}
+
+void test_spsc_wait_timeout(void **state)
+{
+	char value = 0;
+
+	// nothing to remove, so it gives up after the timeout
+	assert_false(spsc_ringbuffer_pop_wait(spsc, &value, 10));
+	assert_false(spsc_ringbuffer_pop_wait(spsc, &value, 0));
+
+	assert_true(spsc_ringbuffer_push_wait(spsc, 'C', 0));
+	assert_true(spsc_ringbuffer_push_wait(spsc, 'o', 10));
+	assert_true(spsc_ringbuffer_push_wait(spsc, 'd', -1));
+	assert_false(spsc_ringbuffer_push_wait(spsc, 'y', 10));
+	assert_int_equal(spsc->producer_waiting, 0);
+
+	assert_true(spsc_ringbuffer_pop_wait(spsc, &value, 10));
+	assert_true(value == 'C');
+	assert_true(spsc_ringbuffer_push_wait(spsc, 'y', 10));
+}
+
+void test_spsc_stats(void **state)
+{
+	char value, out[4];
+
+	spsc_ringbuffer_insert(spsc, 'C');
+	assert_int_equal(spsc_ringbuffer_write(spsc, "ody", 3), 2);
+	assert_false(spsc_ringbuffer_insert(spsc, 'y'));
+	spsc_ringbuffer_remove(spsc, &value);
+	spsc_ringbuffer_read(spsc, out, sizeof(out));
+	assert_false(spsc_ringbuffer_remove(spsc, &value));
+	assert_int_equal(spsc_ringbuffer_read(spsc, out, sizeof(out)), 0);
+
+	ringbuffer_counters stats = spsc_ringbuffer_stats(spsc);
+	assert_int_equal(stats.inserts, 3);
+	assert_int_equal(stats.rejected, 2);
+	assert_int_equal(stats.removes, 3);
+	assert_int_equal(stats.empty_removes, 2);
+	assert_int_equal(stats.high_water, 3);
+	assert_int_equal(stats.overwritten, 0);
+}
+
+#define SPSC_WAIT_STRESS_COUNT (1 << 18)
+
+// Producer for the blocking stress test.
+static void* spsc_wait_producer(void* arg)
+{
+	for (uint32_t i = 0; i < SPSC_WAIT_STRESS_COUNT; ++i)
+		spsc_ringbuffer_push_wait(spsc, (char)i, -1);
+	return NULL;
+}
+
+// Runs a blocking producer against a blocking consumer on a small
+// buffer, so both sides keep going to sleep and waking each other.
+void test_spsc_wait_stress(void **state)
+{
+	pthread_t producer;
+	uint32_t errors = 0;
+	char value;
+
+	spsc = new_spsc_ringbuffer(16);
+	assert_int_equal(pthread_create(&producer, NULL, spsc_wait_producer, NULL), 0);
+
+	for (uint32_t i = 0; i < SPSC_WAIT_STRESS_COUNT; ++i) {
+		if (!spsc_ringbuffer_pop_wait(spsc, &value, 5000)) {
+			++errors;
+			break;
+		}
+		errors += value != (char)i;
+	}
+
+	pthread_join(producer, NULL);
+	assert_int_equal(errors, 0);
+	assert_true(spsc_ringbuffer_isempty(spsc));
+	delete_spsc_ringbuffer(spsc);
+}
+
+void test_new_mpmc_queue(void **state)
+{
+	for (int i = 1; i < 16; ++i) {
+		mpmc = new_mpmc_queue(1 << i);
+		assert_true(mpmc != NULL);
+		assert_true(mpmc->max == (1 << i));
+		assert_true(mpmc->buffer != NULL);
+		delete_mpmc_queue(mpmc);
+	}
+
+	assert_true(new_mpmc_queue(0) == NULL);
+	assert_true(new_mpmc_queue(1) == NULL);
+	for (int i = 0; i < 8; ++i) {
+		mpmc = new_mpmc_queue(11 << i);
+		assert_true(mpmc == NULL);
+	}
+}
+
+void test_mpmc_enqueue_dequeue(void **state)
+{
+	char value = 0;
+
+	mpmc = new_mpmc_queue(4);
+	assert_false(mpmc_queue_dequeue(mpmc, &value));
+
+	// all four slots are usable
+	assert_true(mpmc_queue_enqueue(mpmc, 'C'));
+	assert_true(mpmc_queue_enqueue(mpmc, 'o'));
+	assert_true(mpmc_queue_enqueue(mpmc, 'd'));
+	assert_true(mpmc_queue_enqueue(mpmc, 'y'));
+	assert_false(mpmc_queue_enqueue(mpmc, 'B'));
+
+	assert_true(mpmc_queue_dequeue(mpmc, &value));
+	assert_true(value == 'C');
+
+	// wraps around the end
+	assert_true(mpmc_queue_enqueue(mpmc, 'B'));
+	const char* expected = "odyB";
+	for (int i = 0; i < 4; ++i) {
+		assert_true(mpmc_queue_dequeue(mpmc, &value));
+		assert_true(value == expected[i]);
+	}
+	assert_false(mpmc_queue_dequeue(mpmc, &value));
+
+	delete_mpmc_queue(mpmc);
+}
+
+#define MPMC_STRESS_THREADS 4
+#define MPMC_STRESS_COUNT (1 << 20)
+
+static atomic_uint mpmc_stress_consumed;
+static unsigned mpmc_stress_seen[MPMC_STRESS_THREADS][256];
+
+// Producer for the mpmc stress test. Every producer
+// enqueues the same running sequence.
+static void* mpmc_stress_producer(void* arg)
+{
+	for (uint32_t i = 0; i < MPMC_STRESS_COUNT; ) {
+		if (mpmc_queue_enqueue(mpmc, (char)i))
+			++i;
+		else
+			sched_yield();
+	}
+	return NULL;
+}
+
+// Consumer for the mpmc stress test. Counts how often
+// each value was dequeued until all values are consumed.
+static void* mpmc_stress_consumer(void* arg)
+{
+	unsigned* seen = arg;
+	char value;
+
+	while (atomic_load(&mpmc_stress_consumed) < MPMC_STRESS_THREADS * MPMC_STRESS_COUNT) {
+		if (mpmc_queue_dequeue(mpmc, &value)) {
+			++seen[(unsigned char)value];
+			atomic_fetch_add(&mpmc_stress_consumed, 1);
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+// Runs several producers against several consumers and checks
+// every value comes out exactly once.
+void test_mpmc_stress(void **state)
+{
+	pthread_t producers[MPMC_STRESS_THREADS], consumers[MPMC_STRESS_THREADS];
+	char value;
+
+	mpmc = new_mpmc_queue(256);
+	atomic_init(&mpmc_stress_consumed, 0);
+	memset(mpmc_stress_seen, 0, sizeof(mpmc_stress_seen));
+
+	for (int i = 0; i < MPMC_STRESS_THREADS; ++i) {
+		assert_int_equal(pthread_create(&producers[i], NULL, mpmc_stress_producer, NULL), 0);
+		assert_int_equal(pthread_create(&consumers[i], NULL, mpmc_stress_consumer,
+			mpmc_stress_seen[i]), 0);
+	}
+	for (int i = 0; i < MPMC_STRESS_THREADS; ++i) {
+		pthread_join(producers[i], NULL);
+		pthread_join(consumers[i], NULL);
+	}
+
+	for (int value = 0; value < 256; ++value) {
+		unsigned total = 0;
+		for (int i = 0; i < MPMC_STRESS_THREADS; ++i)
+			total += mpmc_stress_seen[i][value];
+		assert_int_equal(total, MPMC_STRESS_THREADS * MPMC_STRESS_COUNT / 256);
+	}
+	assert_false(mpmc_queue_dequeue(mpmc, &value));
+
+	delete_mpmc_queue(mpmc);
+}
+
+void test_shm_ringbuffer(void **state)
+{
+	char name[64], value = 0, out[4];
+	snprintf(name, sizeof(name), "/ringbuffer_tests_%d", (int)getpid());
+
+	assert_true(new_shm_ringbuffer(name, 11) == NULL);
+	assert_true(open_shm_ringbuffer(name) == NULL);
+
+	shm_ringbuffer* producer = new_shm_ringbuffer(name, 4);
+	assert_true(producer != NULL);
+	assert_true(new_shm_ringbuffer(name, 4) == NULL);
+
+	shm_ringbuffer* consumer = open_shm_ringbuffer(name);
+	assert_true(consumer != NULL);
+	assert_int_equal(consumer->max, 4);
+
+	// the two handles map the same segment at different addresses
+	assert_true(producer->buffer != consumer->buffer);
+	assert_true(shm_ringbuffer_insert(producer, 'C'));
+	assert_int_equal(shm_ringbuffer_write(producer, "ody", 3), 2);
+	assert_false(shm_ringbuffer_insert(producer, 'y'));
+	assert_true(shm_ringbuffer_remove(consumer, &value));
+	assert_true(value == 'C');
+	assert_true(shm_ringbuffer_insert(producer, 'y'));
+	assert_int_equal(shm_ringbuffer_read(consumer, out, sizeof(out)), 3);
+	assert_memory_equal(out, "ody", 3);
+	assert_false(shm_ringbuffer_remove(consumer, &value));
+	assert_true(shm_ringbuffer_isempty(consumer));
+
+	delete_shm_ringbuffer(consumer);
+	delete_shm_ringbuffer(producer);
+	assert_true(open_shm_ringbuffer(name) == NULL);
+}
+
+void test_shm_reattach(void **state)
+{
+	char name[64], data[128], out[128];
+	snprintf(name, sizeof(name), "/ringbuffer_tests_reattach_%d", (int)getpid());
+	memset(data, 'x', sizeof(data));
+
+	shm_ringbuffer* creator = new_shm_ringbuffer(name, 128);
+	shm_ringbuffer* consumer = open_shm_ringbuffer(name);
+	assert_int_equal(shm_ringbuffer_write(creator, data, 100), 100);
+	assert_int_equal(shm_ringbuffer_read(consumer, out, 100), 100);
+	delete_shm_ringbuffer(consumer);
+
+	// A consumer that attaches later only sees what is stored.
+	assert_int_equal(shm_ringbuffer_write(creator, "abc", 3), 3);
+	consumer = open_shm_ringbuffer(name);
+	assert_int_equal(shm_ringbuffer_read(consumer, out, 16), 3);
+	assert_memory_equal(out, "abc", 3);
+	assert_true(shm_ringbuffer_isempty(consumer));
+
+	// So does a producer, after the tail wrapped around.
+	assert_int_equal(shm_ringbuffer_write(creator, data, 60), 60);
+	assert_int_equal(shm_ringbuffer_read(consumer, out, 60), 60);
+	shm_ringbuffer* producer = open_shm_ringbuffer(name);
+	assert_int_equal(shm_ringbuffer_write(producer, data, 10), 10);
+	delete_shm_ringbuffer(producer);
+	producer = open_shm_ringbuffer(name);
+	assert_int_equal(shm_ringbuffer_write(producer, data, sizeof(data)), 117);
+	assert_int_equal(shm_ringbuffer_read(consumer, out, sizeof(out)), 127);
+
+	delete_shm_ringbuffer(producer);
+	delete_shm_ringbuffer(consumer);
+	delete_shm_ringbuffer(creator);
+}
+
+#define SHM_STRESS_COUNT (1 << 22)
+
+// Consumer process for the shm stress test. Attaches by name
+// and checks the values come out complete and in order.
+// 
+// Returns the exit status for the process.
+static int shm_stress_consumer(const char* name)
+{
+	char chunk[37];
+	uint32_t i = 0;
+	shm_ringbuffer* rbuf = open_shm_ringbuffer(name);
+
+	if (rbuf == NULL)
+		return 2;
+
+	while (i < SHM_STRESS_COUNT) {
+		size_t len = shm_ringbuffer_read(rbuf, chunk, sizeof(chunk));
+		if (len == 0)
+			sched_yield();
+		for (size_t j = 0; j < len; ++j, ++i)
+			if (chunk[j] != (char)i)
+				return 1;
+	}
+	return 0;
+}
+
+// Streams a running sequence to a consumer in a second process.
+void test_shm_stress(void **state)
+{
+	char name[64], chunk[61];
+	int status;
+	snprintf(name, sizeof(name), "/ringbuffer_stress_%d", (int)getpid());
+
+	shm_ringbuffer* rbuf = new_shm_ringbuffer(name, 1024);
+	assert_true(rbuf != NULL);
+
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0)
+		_exit(shm_stress_consumer(name));
+	assert_true(pid > 0);
+
+	for (uint32_t i = 0; i < SHM_STRESS_COUNT; ) {
+		size_t len = sizeof(chunk);
+		if (len > SHM_STRESS_COUNT - i)
+			len = SHM_STRESS_COUNT - i;
+		for (size_t j = 0; j < len; ++j)
+			chunk[j] = (char)(i + j);
+		size_t written = shm_ringbuffer_write(rbuf, chunk, len);
+		if (written == 0)
+			sched_yield();
+		i += written;
+	}
+
+	assert_int_equal(waitpid(pid, &status, 0), pid);
+	assert_true(WIFEXITED(status));
+	assert_int_equal(WEXITSTATUS(status), 0);
+	assert_true(shm_ringbuffer_isempty(rbuf));
+	delete_shm_ringbuffer(rbuf);
+}
+
+void test_bcast_ringbuffer(void **state)
+{
+	char value = 0, out[8];
+
+	assert_true(new_bcast_ringbuffer(11) == NULL);
+	bcast_ringbuffer* rbuf = new_bcast_ringbuffer(4);
+	assert_true(rbuf != NULL);
+
+	bcast_ringbuffer_insert(rbuf, 'x');
+	bcast_reader* first = new_bcast_reader(rbuf);
+	bcast_reader* second = new_bcast_reader(rbuf);
+
+	// readers start with the next value and each see every value
+	assert_false(bcast_reader_remove(first, &value));
+	bcast_ringbuffer_write(rbuf, "Cod", 3);
+	assert_true(bcast_reader_remove(first, &value));
+	assert_true(value == 'C');
+	assert_int_equal(bcast_reader_read(second, out, sizeof(out)), 3);
+	assert_memory_equal(out, "Cod", 3);
+
+	// the first reader is lapped and loses two values
+	bcast_ringbuffer_write(rbuf, "yBal", 4);
+	assert_int_equal(bcast_reader_read(first, out, sizeof(out)), 4);
+	assert_memory_equal(out, "yBal", 4);
+	assert_int_equal(bcast_reader_lost(first), 2);
+	assert_int_equal(bcast_reader_read(second, out, sizeof(out)), 4);
+	assert_int_equal(bcast_reader_lost(second), 0);
+
+	// a write longer than the buffer only keeps the last n values
+	bcast_ringbuffer_write(rbuf, "abcdefg", 7);
+	assert_int_equal(bcast_reader_read(first, out, sizeof(out)), 4);
+	assert_memory_equal(out, "defg", 4);
+	assert_int_equal(bcast_reader_lost(first), 5);
+	assert_false(bcast_reader_remove(first, &value));
+
+	delete_bcast_reader(first);
+	delete_bcast_reader(second);
+	delete_bcast_ringbuffer(rbuf);
+}
+
+#define BCAST_STRESS_READERS 3
+#define BCAST_STRESS_COUNT (1 << 22)
+
+static bcast_ringbuffer* bcast;
+
+// Reader for the bcast stress test. Since the writer inserts
+// a running sequence, every value must match the sequence
+// number it was read at, whether or not values were lost.
+// 
+// Returns the number of mismatched values.
+static void* bcast_stress_reader(void* arg)
+{
+	bcast_reader* reader = arg;
+	uintptr_t errors = 0;
+	char chunk[29];
+
+	while (reader->cursor != BCAST_STRESS_COUNT) {
+		size_t len = bcast_reader_read(reader, chunk, sizeof(chunk));
+		if (len == 0) {
+			sched_yield();
+			continue;
+		}
+		uint32_t start = reader->cursor - (uint32_t)len;
+		for (size_t j = 0; j < len; ++j)
+			errors += chunk[j] != (char)(start + j);
+	}
+	return (void*)errors;
+}
+
+void test_bcast_stress(void **state)
+{
+	pthread_t threads[BCAST_STRESS_READERS];
+	bcast_reader* readers[BCAST_STRESS_READERS];
+	char chunk[13];
+
+	bcast = new_bcast_ringbuffer(256);
+	for (int i = 0; i < BCAST_STRESS_READERS; ++i) {
+		readers[i] = new_bcast_reader(bcast);
+		assert_int_equal(pthread_create(&threads[i], NULL, bcast_stress_reader, readers[i]), 0);
+	}
+
+	for (uint32_t i = 0; i < BCAST_STRESS_COUNT; i += sizeof(chunk)) {
+		size_t len = sizeof(chunk);
+		if (len > BCAST_STRESS_COUNT - i)
+			len = BCAST_STRESS_COUNT - i;
+		for (size_t j = 0; j < len; ++j)
+			chunk[j] = (char)(i + j);
+		bcast_ringbuffer_write(bcast, chunk, len);
+		if (i % 1024 == 0)
+			sched_yield();
+	}
+
+	for (int i = 0; i < BCAST_STRESS_READERS; ++i) {
+		void* errors;
+		pthread_join(threads[i], &errors);
+		assert_int_equal((uintptr_t)errors, 0);
+		assert_true(bcast_reader_lost(readers[i]) < BCAST_STRESS_COUNT);
+		delete_bcast_reader(readers[i]);
+	}
+	delete_bcast_ringbuffer(bcast);
+}
+
+void test_grow_ringbuffer(void **state)
+{
+	assert_true(new_grow_ringbuffer(6, 8) == NULL);
+	assert_true(new_grow_ringbuffer(8, 4) == NULL);
+
+	// Uses all of its slots before it grows.
+	grow_ringbuffer* rbuf = new_grow_ringbuffer(4, 4);
+	char value;
+	for (int i = 0; i < 4; ++i)
+		assert_true(grow_ringbuffer_insert(rbuf, 'a' + i));
+	assert_true(grow_ringbuffer_isfull(rbuf));
+	assert_false(grow_ringbuffer_insert(rbuf, 'e'));
+	assert_int_equal(rbuf->max, 4);
+	assert_true(grow_ringbuffer_peek(rbuf, &value));
+	assert_int_equal(value, 'a');
+	for (int i = 0; i < 4; ++i) {
+		assert_true(grow_ringbuffer_remove(rbuf, &value));
+		assert_int_equal(value, 'a' + i);
+	}
+	assert_true(grow_ringbuffer_isempty(rbuf));
+	assert_false(grow_ringbuffer_remove(rbuf, &value));
+	assert_false(grow_ringbuffer_peek(rbuf, &value));
+	delete_grow_ringbuffer(rbuf);
+}
+
+void test_grow_ringbuffer_wrapped(void **state)
+{
+	grow_ringbuffer* rbuf = new_grow_ringbuffer(8, 64);
+	char out[64];
+
+	// Wrap the contents around the end of the buffer, then let
+	// an insert into the full buffer grow it.
+	assert_int_equal(grow_ringbuffer_write(rbuf, "xxxxxx", 6), 6);
+	assert_int_equal(grow_ringbuffer_read(rbuf, out, 6), 6);
+	assert_int_equal(grow_ringbuffer_write(rbuf, "abcdefgh", 8), 8);
+	assert_int_equal(rbuf->max, 8);
+	assert_true(grow_ringbuffer_insert(rbuf, 'i'));
+	assert_int_equal(rbuf->max, 16);
+	assert_int_equal(grow_ringbuffer_count(rbuf), 9);
+
+	// A write larger than the free space grows several times at once.
+	assert_int_equal(grow_ringbuffer_write(rbuf, "jklmnopqrstuvwxyz0123456789", 27), 27);
+	assert_int_equal(rbuf->max, 64);
+	assert_int_equal(grow_ringbuffer_read(rbuf, out, sizeof(out)), 36);
+	assert_memory_equal(out, "abcdefghijklmnopqrstuvwxyz0123456789", 36);
+
+	// Writes stop at the limit.
+	memset(out, 'z', sizeof(out));
+	assert_int_equal(grow_ringbuffer_write(rbuf, out, 40), 40);
+	assert_int_equal(grow_ringbuffer_write(rbuf, out, 40), 24);
+	assert_int_equal(rbuf->max, 64);
+	assert_false(grow_ringbuffer_insert(rbuf, 'z'));
+	delete_grow_ringbuffer(rbuf);
+}
+
+void test_grow_ringbuffer_reserve(void **state)
+{
+	grow_ringbuffer* rbuf = new_grow_ringbuffer(16, 16);
+	char out[16];
+
+	// Wrapped contents survive growing past the limit and shrinking.
+	assert_int_equal(grow_ringbuffer_write(rbuf, "0123456789", 10), 10);
+	assert_int_equal(grow_ringbuffer_read(rbuf, out, 10), 10);
+	assert_int_equal(grow_ringbuffer_write(rbuf, "abcdefghij", 10), 10);
+	assert_true(grow_ringbuffer_reserve(rbuf, 100));
+	assert_int_equal(rbuf->max, 128);
+	assert_int_equal(grow_ringbuffer_count(rbuf), 10);
+
+	assert_true(grow_ringbuffer_reserve(rbuf, 3));
+	assert_int_equal(rbuf->max, 16);
+	assert_int_equal(grow_ringbuffer_read(rbuf, out, 4), 4);
+	assert_memory_equal(out, "abcd", 4);
+	assert_true(grow_ringbuffer_reserve(rbuf, 0));
+	assert_int_equal(rbuf->max, 8);
+	assert_int_equal(grow_ringbuffer_write(rbuf, "kl", 2), 2);
+	assert_true(grow_ringbuffer_isfull(rbuf));
+	assert_int_equal(grow_ringbuffer_read(rbuf, out, sizeof(out)), 8);
+	assert_memory_equal(out, "efghijkl", 8);
+
+	assert_true(grow_ringbuffer_reserve(rbuf, 0));
+	assert_int_equal(rbuf->max, 1);
+
+	// 2^31 is the largest size the free-running indices can tell apart
+	assert_false(grow_ringbuffer_reserve(rbuf, (1u << 31) + 1));
+	assert_int_equal(rbuf->max, 1);
+	delete_grow_ringbuffer(rbuf);
+}
+
+// Runs the tests one after another in this process. With --jobs,
+// --timeout or --summary they run in worker processes instead, up to
+// n at a time (0 for one per core), each limited to ms milliseconds,
+// and the status and duration of each test are written to file.
+// 
+// Usage: tests [--jobs n] [--timeout ms] [--summary file]
+int main(int argc, char** argv)
+{
+	TestRunOptions options = { 0, 0, NULL };
+	bool parallel = false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+			options.jobs = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+			options.timeout_ms = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--summary") == 0 && i + 1 < argc)
+			options.summary_file = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [--jobs n] [--timeout ms] [--summary file]\n", argv[0]);
+			return 1;
+		}
+		parallel = true;
+	}
+
 	const UnitTest tests[] = {
 		unit_test(test_new_ringbuffer),
 		unit_test_setup_teardown(test_rbuffer_insert, setup_rbuffer, teardown_rbuffer),
@@ -132,8 +1169,40 @@ int main(void)
 		unit_test_setup_teardown(test_rbuffer_remove, setup_rbuffer, teardown_rbuffer),
 		unit_test_setup_teardown(test_rbuffer_peek, setup_rbuffer, teardown_rbuffer),
 		unit_test_setup_teardown(test_rbuffer_isfull, setup_rbuffer, teardown_rbuffer),
-		unit_test_setup_teardown(test_rbuffer_isempty, setup_rbuffer, teardown_rbuffer)
+		unit_test_setup_teardown(test_rbuffer_isempty, setup_rbuffer, teardown_rbuffer),
+		unit_test_setup_teardown(test_rbuffer_write, setup_rbuffer, teardown_rbuffer),
+		unit_test_setup_teardown(test_rbuffer_sfwrite, setup_rbuffer, teardown_rbuffer),
+		unit_test_setup_teardown(test_rbuffer_read, setup_rbuffer, teardown_rbuffer),
+		unit_test_setup_teardown(test_rbuffer_peekn, setup_rbuffer, teardown_rbuffer),
+		unit_test_setup_teardown(test_rbuffer_stats, setup_rbuffer, teardown_rbuffer),
+		unit_test_setup_teardown(test_rbuffer_spans, setup_rbuffer, teardown_rbuffer),
+		unit_test(test_rbuffer_find),
+		unit_test(test_rbuffer_read_frame),
+		unit_test(test_mirrored_ringbuffer),
+		unit_test(test_template_u64),
+		unit_test(test_template_record),
+		unit_test(test_new_spsc_ringbuffer),
+		unit_test_setup_teardown(test_spsc_insert_remove, setup_spsc, teardown_spsc),
+		unit_test_setup_teardown(test_spsc_write_read, setup_spsc, teardown_spsc),
+		unit_test(test_spsc_stress),
+		unit_test(test_spsc_stress_bulk),
+		unit_test_setup_teardown(test_spsc_wait_timeout, setup_spsc, teardown_spsc),
+		unit_test_setup_teardown(test_spsc_stats, setup_spsc, teardown_spsc),
+		unit_test(test_spsc_wait_stress),
+		unit_test(test_new_mpmc_queue),
+		unit_test(test_mpmc_enqueue_dequeue),
+		unit_test(test_mpmc_stress),
+		unit_test(test_shm_ringbuffer),
+		unit_test(test_shm_reattach),
+		unit_test(test_shm_stress),
+		unit_test(test_bcast_ringbuffer),
+		unit_test(test_bcast_stress),
+		unit_test(test_grow_ringbuffer),
+		unit_test(test_grow_ringbuffer_wrapped),
+		unit_test(test_grow_ringbuffer_reserve)
 	};
 
+	if (parallel)
+		return run_tests_parallel(tests, &options);
 	return run_tests(tests);
 }
\ No newline at end of file
@@ -22,6 +22,10 @@
 #include <setjmp.h>
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 #endif // !_WIN32
 #include <stdarg.h>
 #include <stddef.h>
@@ -125,6 +129,16 @@ typedef struct SymbolMapValue {
     ListNode symbol_values_list_head;
 } SymbolMapValue;
 
+/* Entry of the symbol map index.  Symbols are keyed by the list they are in
+ * and their name, since symbol maps are nested.  A slot is free when head is
+ * NULL. */
+typedef struct SymbolMapIndexEntry {
+    const ListNode *head;     // Symbol map list that contains the symbol.
+    const char *symbol_name;  // Name of the symbol.
+    size_t hash;              // Hash of head and symbol_name.
+    ListNode *node;           // Node referencing the symbol's SymbolMapValue.
+} SymbolMapIndexEntry;
+
 // Used by list_free() to deallocate values referenced by list nodes.
 typedef void (*CleanupListValue)(const void *value, void *cleanup_value_data);
 
@@ -161,14 +175,21 @@ static void list_remove_free(
     ListNode * const node, const CleanupListValue cleanup_value,
     void * const cleanup_value_data);
 static int list_empty(const ListNode * const head);
-static int list_find(
-    ListNode * const head, const void *value,
-    const EqualityFunction equal_func, ListNode **output);
 static int list_first(ListNode * const head, ListNode **output);
 static ListNode* list_free(
     ListNode * const head, const CleanupListValue cleanup_value,
     void * const cleanup_value_data);
 
+static int symbol_map_index_find(
+    const ListNode * const head, const char * const symbol_name,
+    ListNode **output);
+static void symbol_map_index_add(
+    const ListNode * const head, const char * const symbol_name,
+    ListNode * const node);
+static void symbol_map_index_remove(
+    const ListNode * const head, const char * const symbol_name);
+static void symbol_map_index_free(void);
+
 static void add_symbol_value(
     ListNode * const symbol_map_head, const char * const symbol_names[],
     const size_t number_of_symbol_names, const void* value, const int count);
@@ -212,9 +233,29 @@ static ListNode global_function_parameter_map_head;
 // Location of last parameter value checked was declared.
 static SourceLocation global_last_parameter_location;
 
+/* Open addressing hash table which indexes the nodes of all symbol map lists
+ * so symbols are found without a linear scan of their list.  Uses linear
+ * probing and its size is always a power of 2. */
+static SymbolMapIndexEntry *global_symbol_map_index;
+static size_t global_symbol_map_index_size;
+static size_t global_symbol_map_index_entries;
+
 // List of all currently allocated blocks.
 static ListNode global_allocated_blocks;
 
+// Whether allocated and freed blocks are filled with a pattern.
+static int global_malloc_fill_patterns = 1;
+
+// Expected contents of a guard block.
+static const unsigned char global_malloc_guard[MALLOC_GUARD_SIZE] = {
+    MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN,
+    MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN,
+    MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN,
+    MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN,
+    MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN, MALLOC_GUARD_PATTERN,
+    MALLOC_GUARD_PATTERN,
+};
+
 #ifndef _WIN32
 // Signals caught by exception_handler().
 static const int exception_signals[] = {
@@ -340,6 +381,7 @@ void teardown_testing(const char *test_name) {
     list_free(&global_function_parameter_map_head, free_symbol_map_value,
               (void*)1);
     initialize_source_location(&global_last_parameter_location);
+    symbol_map_index_free();
 }
 
 // Initialize a list node.
@@ -424,22 +466,6 @@ static int list_empty(const ListNode * const head) {
 }
 
 
-/* Find a value in the list using the equal_func to compare each node with the
- * value.
- */
-static int list_find(ListNode * const head, const void *value,
-                     const EqualityFunction equal_func, ListNode **output) {
-    ListNode *current;
-    assert_true(head);
-    for (current = head->next; current != head; current = current->next) {
-        if (equal_func(current->value, value)) {
-            *output = current;
-            return 1;
-        }
-    }
-    return 0;
-}
-
 // Returns the first node of a list
 static int list_first(ListNode * const head, ListNode **output) {
     ListNode *target_node;
@@ -473,11 +499,130 @@ static void free_symbol_map_value(const void *value,
 }
 
 
-/* Determine whether a symbol name referenced by a symbol_map_value
- * matches the specified function name. */
-static int symbol_names_match(const void *map_value, const void *symbol) {
-    return !strcmp(((SymbolMapValue*)map_value)->symbol_name,
-                   (const char*)symbol);
+// Calculates the index hash of a symbol within the specified symbol map list.
+static size_t symbol_map_hash(const ListNode * const head,
+                              const char * const symbol_name) {
+    // FNV-1a of the name, seeded with the address of the list.
+    size_t hash = (size_t)2166136261U ^ ((size_t)head >> 4);
+    const unsigned char *name = (const unsigned char*)symbol_name;
+    while (*name) {
+        hash = (hash ^ *name++) * (size_t)16777619U;
+    }
+    return hash ^ (hash >> 16);
+}
+
+
+/* Finds the index slot of a symbol within the specified symbol map list.
+ * Returns the slot of the symbol if it's indexed, otherwise the free slot
+ * where it would be added. */
+static size_t symbol_map_index_slot(const ListNode * const head,
+                                    const char * const symbol_name,
+                                    const size_t hash) {
+    const size_t mask = global_symbol_map_index_size - 1;
+    size_t slot = hash & mask;
+    for (;;) {
+        const SymbolMapIndexEntry * const entry =
+            &global_symbol_map_index[slot];
+        if (!entry->head ||
+            (entry->hash == hash && entry->head == head &&
+             !strcmp(entry->symbol_name, symbol_name))) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+
+/* Finds the node of a symbol within the specified symbol map list.
+ * Returns 1 and sets output if the symbol is found, 0 otherwise. */
+static int symbol_map_index_find(
+        const ListNode * const head, const char * const symbol_name,
+        ListNode **output) {
+    const SymbolMapIndexEntry *entry;
+    assert_true(head);
+    assert_true(symbol_name);
+    if (!global_symbol_map_index_entries) {
+        return 0;
+    }
+    entry = &global_symbol_map_index[symbol_map_index_slot(
+        head, symbol_name, symbol_map_hash(head, symbol_name))];
+    if (!entry->head) {
+        return 0;
+    }
+    *output = entry->node;
+    return 1;
+}
+
+
+/* Adds the node of a symbol within the specified symbol map list to the
+ * index.  The index is grown so that it's never more than half full. */
+static void symbol_map_index_add(
+        const ListNode * const head, const char * const symbol_name,
+        ListNode * const node) {
+    const size_t hash = symbol_map_hash(head, symbol_name);
+    SymbolMapIndexEntry *entry;
+    if ((global_symbol_map_index_entries + 1) * 2 >
+        global_symbol_map_index_size) {
+        SymbolMapIndexEntry * const old_index = global_symbol_map_index;
+        const size_t old_size = global_symbol_map_index_size;
+        size_t i;
+        global_symbol_map_index_size = old_size ? old_size * 2 : 64;
+        global_symbol_map_index = (SymbolMapIndexEntry*)calloc(
+            global_symbol_map_index_size, sizeof(*global_symbol_map_index));
+        assert_true(global_symbol_map_index);
+        for (i = 0; i < old_size; i++) {
+            if (old_index[i].head) {
+                global_symbol_map_index[symbol_map_index_slot(
+                    old_index[i].head, old_index[i].symbol_name,
+                    old_index[i].hash)] = old_index[i];
+            }
+        }
+        free(old_index);
+    }
+
+    entry = &global_symbol_map_index[symbol_map_index_slot(head, symbol_name,
+                                                           hash)];
+    assert_false(entry->head);
+    entry->head = head;
+    entry->symbol_name = symbol_name;
+    entry->hash = hash;
+    entry->node = node;
+    global_symbol_map_index_entries ++;
+}
+
+
+/* Removes a symbol within the specified symbol map list from the index.
+ * Entries that follow it in the same probe sequence are shifted back so
+ * lookups never need to skip removed slots. */
+static void symbol_map_index_remove(
+        const ListNode * const head, const char * const symbol_name) {
+    const size_t mask = global_symbol_map_index_size - 1;
+    size_t slot, next;
+    assert_true(global_symbol_map_index_entries);
+    slot = symbol_map_index_slot(head, symbol_name,
+                                 symbol_map_hash(head, symbol_name));
+    assert_true(global_symbol_map_index[slot].head);
+
+    for (next = (slot + 1) & mask; global_symbol_map_index[next].head;
+         next = (next + 1) & mask) {
+        // Move the entry back unless its home slot lies in (slot, next].
+        const size_t home = global_symbol_map_index[next].hash & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            global_symbol_map_index[slot] = global_symbol_map_index[next];
+            slot = next;
+        }
+    }
+    global_symbol_map_index[slot].head = NULL;
+    global_symbol_map_index_entries --;
+}
+
+
+// Frees the symbol map index.
+static void symbol_map_index_free(void) {
+    free(global_symbol_map_index);
+    global_symbol_map_index = NULL;
+    global_symbol_map_index_size = 0;
+    global_symbol_map_index_entries = 0;
 }
 
 
@@ -496,14 +641,14 @@ static void add_symbol_value(ListNode * const symbol_map_head,
     assert_true(number_of_symbol_names);
     symbol_name = symbol_names[0];
 
-    if (!list_find(symbol_map_head, symbol_name, symbol_names_match,
-                   &target_node)) {
+    if (!symbol_map_index_find(symbol_map_head, symbol_name, &target_node)) {
         SymbolMapValue * const new_symbol_map_value =
             malloc(sizeof(*new_symbol_map_value));
         new_symbol_map_value->symbol_name = symbol_name;
         list_initialize(&new_symbol_map_value->symbol_values_list_head);
         target_node = list_add_value(symbol_map_head, new_symbol_map_value,
                                           1);
+        symbol_map_index_add(symbol_map_head, symbol_name, target_node);
     }
 
     target_map_value = (SymbolMapValue*)target_node->value;
@@ -535,7 +680,7 @@ static int get_symbol_value(
     assert_true(output);
     symbol_name = symbol_names[0];
 
-    if (list_find(head, symbol_name, symbol_names_match, &target_node)) {
+    if (symbol_map_index_find(head, symbol_name, &target_node)) {
         SymbolMapValue *map_value;
         ListNode *child_list;
         int return_value = 0;
@@ -560,6 +705,7 @@ static int get_symbol_value(
                 output);
         }
         if (list_empty(child_list)) {
+            symbol_map_index_remove(head, symbol_name);
             list_remove_free(target_node, free_symbol_map_value, (void*)0);
         }
         return return_value;
@@ -601,6 +747,7 @@ static void remove_always_return_values(ListNode * const map_head,
         }
 
         if (list_empty(child_list)) {
+            symbol_map_index_remove(map_head, value->symbol_name);
             list_remove_free(current, free_value, NULL);
         }
         current = next;
@@ -1335,6 +1482,11 @@ static ListNode* get_allocated_blocks_list() {
     return &global_allocated_blocks;
 }
 
+void set_malloc_fill_patterns(const int fill_patterns) {
+    global_malloc_fill_patterns = fill_patterns;
+}
+
+
 // Use the real malloc in this function.
 #undef malloc
 void* _test_malloc(const size_t size, const char* file, const int line) {
@@ -1353,7 +1505,9 @@ void* _test_malloc(const size_t size, const char* file, const int line) {
     // Initialize the guard blocks.
     memset(ptr - MALLOC_GUARD_SIZE, MALLOC_GUARD_PATTERN, MALLOC_GUARD_SIZE);
     memset(ptr + size, MALLOC_GUARD_PATTERN, MALLOC_GUARD_SIZE);
-    memset(ptr, MALLOC_ALLOC_PATTERN, size);
+    if (global_malloc_fill_patterns) {
+        memset(ptr, MALLOC_ALLOC_PATTERN, size);
+    }
 
     block_info = (MallocBlockInfo*)(ptr - (MALLOC_GUARD_SIZE +
                                              sizeof(*block_info)));
@@ -1394,6 +1548,10 @@ void _test_free(void* const ptr, const char* file, const int line) {
         for (i = 0; i < ARRAY_LENGTH(guards); i++) {
             unsigned int j;
             char * const guard = guards[i];
+            // Only look for the corrupt byte if the guard doesn't match.
+            if (!memcmp(guard, global_malloc_guard, MALLOC_GUARD_SIZE)) {
+                continue;
+            }
             for (j = 0; j < MALLOC_GUARD_SIZE; j++) {
                 const char diff = guard[j] - MALLOC_GUARD_PATTERN;
                 if (diff) {
@@ -1411,7 +1569,9 @@ void _test_free(void* const ptr, const char* file, const int line) {
     list_remove(&block_info->node, NULL, NULL);
 
     block = block_info->block;
-    memset(block, MALLOC_FREE_PATTERN, block_info->allocated_size);
+    if (global_malloc_fill_patterns) {
+        memset(block, MALLOC_FREE_PATTERN, block_info->allocated_size);
+    }
     free(block);
 }
 #define free test_free
@@ -1639,19 +1799,21 @@ int _run_test(
 }
 
 
-int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
+/* Runs tests in order, pairing each setup function with the next unpaired
+ * teardown function.  Adds the number of executed and failed tests to
+ * tests_executed and total_failed, and records the name of each failed test
+ * in failed_names.  Returns 0 if all setup and teardown functions were
+ * paired, -1 otherwise. */
+static int run_test_sequence(
+        const UnitTest * const tests, const size_t number_of_tests,
+        size_t * const tests_executed, size_t * const total_failed,
+        const char ** const failed_names) {
     // Whether to execute the next test.
     int run_next_test = 1;
     // Whether the previous test failed.
     int previous_test_failed = 0;
-    // Check point of the heap state.
-    const ListNode * const check_point = check_point_allocated_blocks();
     // Current test being executed.
     size_t current_test = 0;
-    // Number of tests executed.
-    size_t tests_executed = 0;
-    // Number of failed tests.
-    size_t total_failed = 0;
     // Number of setup functions.
     size_t setups = 0;
     // Number of teardown functions.
@@ -1660,12 +1822,7 @@ int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
      * when a test setup occurs and popped on tear down. */
     TestState* test_states = malloc(number_of_tests * sizeof(*test_states));
     size_t number_of_test_states = 0;
-    // Names of the tests that failed.
-    const char** failed_names = malloc(number_of_tests *
-                                       sizeof(*failed_names));
     void **current_state = NULL;
-    // Make sure LargestIntegralType is at least the size of a pointer.
-    assert_true(sizeof(LargestIntegralType) >= sizeof(void*));
 
     while (current_test < number_of_tests) {
         const ListNode *test_check_point = NULL;
@@ -1709,20 +1866,20 @@ int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
             int failed = _run_test(test->name, test->function, current_state,
                                    test->function_type, test_check_point);
             if (failed) {
-                failed_names[total_failed] = test->name;
+                failed_names[*total_failed] = test->name;
             }
 
             switch (test->function_type) {
             case UNIT_TEST_FUNCTION_TYPE_TEST:
                 previous_test_failed = failed;
-                total_failed += failed;
-                tests_executed ++;
+                *total_failed += failed;
+                (*tests_executed) ++;
                 break;
 
             case UNIT_TEST_FUNCTION_TYPE_SETUP:
                 if (failed) {
-                    total_failed ++;
-                    tests_executed ++;
+                    (*total_failed) ++;
+                    (*tests_executed) ++;
                     // Skip forward until the next test or setup function.
                     run_next_test = 0;
                 }
@@ -1732,7 +1889,7 @@ int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
             case UNIT_TEST_FUNCTION_TYPE_TEARDOWN:
                 // If this test failed.
                 if (failed && !previous_test_failed) {
-                    total_failed ++;
+                    (*total_failed) ++;
                 }
                 break;
             default:
@@ -1742,6 +1899,34 @@ int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
         }
     }
 
+    free(test_states);
+
+    if (number_of_test_states) {
+        print_error("Mismatched number of setup %d and teardown %d "
+                    "functions\n", setups, teardowns);
+        return -1;
+    }
+    return 0;
+}
+
+
+int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
+    // Check point of the heap state.
+    const ListNode * const check_point = check_point_allocated_blocks();
+    // Number of tests executed.
+    size_t tests_executed = 0;
+    // Number of failed tests.
+    size_t total_failed = 0;
+    // Names of the tests that failed.
+    const char** failed_names = malloc(number_of_tests *
+                                       sizeof(*failed_names));
+    int mismatched;
+    // Make sure LargestIntegralType is at least the size of a pointer.
+    assert_true(sizeof(LargestIntegralType) >= sizeof(void*));
+
+    mismatched = run_test_sequence(tests, number_of_tests, &tests_executed,
+                                   &total_failed, failed_names);
+
     if (total_failed) {
         size_t i;
         print_error("%d out of %d tests failed!\n", total_failed,
@@ -1753,15 +1938,322 @@ int _run_tests(const UnitTest * const tests, const size_t number_of_tests) {
         print_message("All %d tests passed\n", tests_executed);
     }
 
-    if (number_of_test_states) {
-        print_error("Mismatched number of setup %d and teardown %d "
-                    "functions\n", setups, teardowns);
+    if (mismatched) {
         total_failed = -1;
     }
 
-    free(test_states);
     free((void*)failed_names);
 
     fail_if_blocks_allocated(check_point, "run_tests");
     return (int)total_failed;
 }
+
+
+#ifndef _WIN32
+// Counts reported by a worker process for its group of tests.
+typedef struct TestGroupResult {
+    size_t tests_executed;
+    size_t total_failed;
+    int mismatched;
+} TestGroupResult;
+
+// Tests run by one worker process: a test and its setup and teardown.
+typedef struct TestGroup {
+    const UnitTest *tests;       // First function of the group.
+    size_t number_of_tests;      // Number of functions in the group.
+    const char *name;            // Name of the test the group runs.
+    pid_t pid;                   // Worker running the group, 0 if none.
+    int result_fd;               // Pipe the worker reports its counts on.
+    double start;                // When the worker was started.
+    double duration;             // Seconds the worker ran for.
+    const char *status;          // "passed", "failed", "timeout" or "crashed".
+    TestGroupResult result;
+} TestGroup;
+
+
+// Get a monotonic wall clock time in seconds.
+static double get_wall_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+
+/* Splits tests into groups which each hold a setup function, the functions up
+ * to the teardown function paired with it, and that teardown function, or a
+ * single test without setup.  Entries without a function are kept with their
+ * neighbours.  Returns the number of groups stored in groups. */
+static size_t split_test_groups(const UnitTest * const tests,
+                                const size_t number_of_tests,
+                                TestGroup * const groups) {
+    size_t number_of_groups = 0;
+    size_t first = 0;
+    size_t depth = 0;
+    const char *name = NULL;
+    const char *first_name = NULL;
+    size_t i;
+
+    for (i = 0; i < number_of_tests; i++) {
+        const UnitTest * const test = &tests[i];
+        if (test->function) {
+            if (test->function_type == UNIT_TEST_FUNCTION_TYPE_SETUP) {
+                depth ++;
+            } else if (test->function_type ==
+                       UNIT_TEST_FUNCTION_TYPE_TEARDOWN && depth) {
+                depth --;
+            } else if (test->function_type == UNIT_TEST_FUNCTION_TYPE_TEST &&
+                       !name) {
+                name = test->name;
+            }
+            if (!first_name) {
+                first_name = test->name;
+            }
+        }
+
+        // Close the group once all its setups are paired, or at the end.
+        if ((!depth || i + 1 == number_of_tests) && first_name) {
+            TestGroup * const group = &groups[number_of_groups++];
+            memset(group, 0, sizeof(*group));
+            group->tests = &tests[first];
+            group->number_of_tests = i + 1 - first;
+            group->name = name ? name : first_name;
+            group->result_fd = -1;
+            first = i + 1;
+            name = NULL;
+            first_name = NULL;
+        } else if (!depth && !first_name) {
+            first = i + 1;
+        }
+    }
+    return number_of_groups;
+}
+
+
+/* Runs a group of tests in a worker process and reports the counts on fd.
+ * Setup and teardown pairing and heap checks are the same as in
+ * _run_tests(), and so are the messages printed. */
+static void run_test_group_worker(const TestGroup * const group,
+                                  const int fd) {
+    const ListNode * const check_point = check_point_allocated_blocks();
+    const char** failed_names = malloc(group->number_of_tests *
+                                       sizeof(*failed_names));
+    TestGroupResult result;
+    int allocated_blocks;
+    memset(&result, 0, sizeof(result));
+
+    result.mismatched = run_test_sequence(
+        group->tests, group->number_of_tests, &result.tests_executed,
+        &result.total_failed, failed_names);
+    free((void*)failed_names);
+
+    allocated_blocks = display_allocated_blocks(check_point);
+    if (allocated_blocks) {
+        free_allocated_blocks(check_point);
+        print_error("ERROR: %s leaked %d block(s)\n", group->name,
+                    allocated_blocks);
+        if (!result.total_failed) {
+            result.total_failed = 1;
+        }
+    }
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        print_error("%s: Failed to report the test results\n", group->name);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+
+/* Starts a worker process for a group of tests.  Returns 1 if the worker
+ * started, 0 otherwise. */
+static int start_test_group(TestGroup * const group) {
+    int fds[2];
+    if (pipe(fds)) {
+        return 0;
+    }
+    // Don't let the worker inherit buffered output.
+    fflush(stdout);
+    fflush(stderr);
+    group->start = get_wall_time();
+    group->pid = fork();
+    if (group->pid < 0) {
+        group->pid = 0;
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+    }
+    /* Put the worker in its own process group, so processes forked by its
+     * tests can be killed along with it.  Both sides set it to avoid racing
+     * with an early timeout. */
+    if (!group->pid) {
+        setpgid(0, 0);
+        close(fds[0]);
+        run_test_group_worker(group, fds[1]);
+    }
+    setpgid(group->pid, group->pid);
+    close(fds[1]);
+    group->result_fd = fds[0];
+    return 1;
+}
+
+
+/* Collects the counts of a group of tests once its worker process exited
+ * with the specified status. */
+static void finish_test_group(TestGroup * const group, const int status) {
+    group->duration = get_wall_time() - group->start;
+    group->pid = 0;
+
+    if (group->status || !WIFEXITED(status) ||
+        read(group->result_fd, &group->result, sizeof(group->result)) !=
+        sizeof(group->result)) {
+        // Count the test as executed and failed if the worker didn't report.
+        if (!group->status) {
+            print_error("%s: Test process exited abnormally\n", group->name);
+            group->status = "crashed";
+        }
+        group->result.tests_executed = 1;
+        group->result.total_failed = 1;
+    } else {
+        group->status = group->result.total_failed || group->result.mismatched ?
+            "failed" : "passed";
+    }
+    close(group->result_fd);
+    group->result_fd = -1;
+}
+
+
+/* Writes the status and duration of each group of tests and the totals of
+ * the run to a file as a JSON object. */
+static void write_test_summary(const char * const summary_file,
+                               const TestGroup * const groups,
+                               const size_t number_of_groups,
+                               const size_t jobs, const size_t tests_executed,
+                               const size_t total_failed) {
+    size_t i;
+    FILE * const summary = fopen(summary_file, "w");
+    if (!summary) {
+        print_error("Unable to write the test summary to %s\n",
+                    summary_file);
+        return;
+    }
+    fprintf(summary, "{\"jobs\": %lu, \"executed\": %lu, \"failed\": %lu, "
+            "\"tests\": [", (unsigned long)jobs,
+            (unsigned long)tests_executed, (unsigned long)total_failed);
+    for (i = 0; i < number_of_groups; i++) {
+        fprintf(summary, "%s\n  {\"name\": \"%s\", \"status\": \"%s\", "
+                "\"seconds\": %.6f}", i ? "," : "", groups[i].name,
+                groups[i].status, groups[i].duration);
+    }
+    fprintf(summary, "\n]}\n");
+    fclose(summary);
+}
+#endif // !_WIN32
+
+
+int _run_tests_parallel(const UnitTest * const tests,
+                        const size_t number_of_tests,
+                        const TestRunOptions * const options) {
+#ifndef _WIN32
+    // Check point of the heap state.
+    const ListNode * const check_point = check_point_allocated_blocks();
+    TestGroup * const groups = malloc(number_of_tests * sizeof(*groups));
+    const size_t number_of_groups = split_test_groups(tests, number_of_tests,
+                                                      groups);
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t jobs = options->jobs;
+    // Next group to start.
+    size_t next_group = 0;
+    // Number of groups whose worker is running.
+    size_t running = 0;
+    // Number of tests executed.
+    size_t tests_executed = 0;
+    // Number of failed tests.
+    size_t total_failed = 0;
+    int mismatched = 0;
+    size_t i;
+    // Make sure LargestIntegralType is at least the size of a pointer.
+    assert_true(sizeof(LargestIntegralType) >= sizeof(void*));
+
+    if (!jobs || (cores > 0 && jobs > (size_t)cores)) {
+        jobs = cores > 0 ? (size_t)cores : 1;
+    }
+    if (jobs > number_of_groups) {
+        jobs = number_of_groups;
+    }
+
+    while (next_group < number_of_groups || running) {
+        const struct timespec poll_interval = {0, 1000000};
+        double now;
+
+        while (running < jobs && next_group < number_of_groups) {
+            TestGroup * const group = &groups[next_group++];
+            if (start_test_group(group)) {
+                running ++;
+            } else {
+                print_error("%s: Unable to start a test process\n",
+                            group->name);
+                group->status = "crashed";
+                group->result.tests_executed = 1;
+                group->result.total_failed = 1;
+            }
+        }
+
+        now = get_wall_time();
+        for (i = 0; i < next_group; i++) {
+            TestGroup * const group = &groups[i];
+            int status;
+            if (!group->pid) {
+                continue;
+            }
+            if (waitpid(group->pid, &status, WNOHANG) == group->pid) {
+                finish_test_group(group, status);
+                running --;
+            } else if (options->timeout_ms && !group->status &&
+                       (now - group->start) * 1000 > options->timeout_ms) {
+                // The worker is reaped on a later pass.
+                print_error("%s: Test timed out after %u ms\n", group->name,
+                            options->timeout_ms);
+                group->status = "timeout";
+                kill(-group->pid, SIGKILL);
+            }
+        }
+        nanosleep(&poll_interval, NULL);
+    }
+
+    for (i = 0; i < number_of_groups; i++) {
+        tests_executed += groups[i].result.tests_executed;
+        total_failed += groups[i].result.total_failed;
+        mismatched |= groups[i].result.mismatched;
+    }
+
+    if (total_failed) {
+        print_error("%d out of %d tests failed!\n", total_failed,
+                    tests_executed);
+        for (i = 0; i < number_of_groups; i++) {
+            if (groups[i].result.total_failed) {
+                print_error("    %s\n", groups[i].name);
+            }
+        }
+    } else {
+        print_message("All %d tests passed\n", tests_executed);
+    }
+
+    if (options->summary_file) {
+        write_test_summary(options->summary_file, groups, number_of_groups,
+                           jobs, tests_executed, total_failed);
+    }
+
+    if (mismatched) {
+        total_failed = -1;
+    }
+
+    free(groups);
+
+    fail_if_blocks_allocated(check_point, "run_tests");
+    return (int)total_failed;
+#else // _WIN32
+    // Worker processes need fork(), so run the tests in this process.
+    return _run_tests(tests, number_of_tests);
+#endif // !_WIN32
+}
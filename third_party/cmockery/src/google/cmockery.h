@@ -268,11 +268,41 @@
  */
 #define run_tests(tests) _run_tests(tests, sizeof(tests) / sizeof(tests)[0])
 
+/*
+ * Run tests specified by an array of UnitTest structures like run_tests(), but
+ * in worker processes.  Each test runs in its own process along with its setup
+ * and teardown functions, so a crash or a hang only fails that test.  A test
+ * that times out is killed along with any processes it forked.  Heap
+ * checks and the pairing of setup and teardown functions apply within each
+ * process.  The following example runs the tests on up to 4 processes and
+ * fails any test that takes longer than 10 seconds.
+ *
+ * int main(int argc, char* argv[]) {
+ *     const UnitTest tests[] = {
+ *         unit_test(Test0);
+ *         unit_test(Test1);
+ *     };
+ *     const TestRunOptions options = { 4, 10000, "summary.json" };
+ *     return run_tests_parallel(tests, &options);
+ * }
+ *
+ * Not supported on Windows, where the tests run like run_tests().
+ */
+#define run_tests_parallel(tests, options) \
+    _run_tests_parallel(tests, sizeof(tests) / sizeof(tests)[0], options)
+
 // Dynamic allocators
 #define test_malloc(size) _test_malloc(size, __FILE__, __LINE__)
 #define test_calloc(num, size) _test_calloc(num, size, __FILE__, __LINE__)
 #define test_free(ptr) _test_free(ptr, __FILE__, __LINE__)
 
+/* Selects whether test_malloc() fills each new block with a pattern and
+ * test_free() fills each released block with another pattern, which makes
+ * uses of uninitialized or freed memory easier to spot.  Guard bytes around
+ * each block are written and checked either way.  Filling is enabled by
+ * default, disabling it speeds up tests that allocate heavily. */
+void set_malloc_fill_patterns(const int fill_patterns);
+
 // Redirect malloc, calloc and free to the unit test allocators.
 #if UNIT_TESTING
 #define malloc test_malloc
@@ -338,6 +368,18 @@ typedef struct UnitTest {
 } UnitTest;
 
 
+// Options of run_tests_parallel().
+typedef struct TestRunOptions {
+    // Maximum number of worker processes, 0 or more than the number of cores
+    // for one per core.
+    size_t jobs;
+    // Wall clock time a test may take in milliseconds, 0 for no limit.
+    unsigned int timeout_ms;
+    /* File the status and duration of each test are written to as JSON, or
+     * NULL for none. */
+    const char *summary_file;
+} TestRunOptions;
+
 // Location within some source code.
 typedef struct SourceLocation {
     const char* file;
@@ -474,6 +516,9 @@ int _run_test(
     void ** const state, const UnitTestFunctionType function_type,
     const void* const heap_check_point);
 int _run_tests(const UnitTest * const tests, const size_t number_of_tests);
+int _run_tests_parallel(const UnitTest * const tests,
+                        const size_t number_of_tests,
+                        const TestRunOptions * const options);
 
 // Standard output and error print methods.
 void print_message(const char* const format, ...);